@@ -0,0 +1,843 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Standard header files
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvBatch.h"
+#include "riscvCommitRing.h"
+#include "riscvExceptions.h"
+#include "riscvMessage.h"
+#include "riscvPageTracker.h"
+#include "riscvSemiHost.h"
+#include "riscvSignature.h"
+#include "riscvStructure.h"
+#include "riscvVM.h"
+
+
+//
+// Batch list and path limits
+//
+#define BATCH_MAX_LINE      4096
+#define BATCH_SIG_SUFFIX    ".signature.output"
+#define BATCH_BACKLOG       64
+
+//
+// ELF constants
+//
+#define ELF_CLASS_32        1
+#define ELF_CLASS_64        2
+#define ELF_DATA_LSB        1
+#define ELF_PT_LOAD         1
+#define ELF_SHT_SYMTAB      2
+
+//
+// This holds an ELF file image
+//
+typedef struct elfImageS {
+    Uns8  *data;            // file contents
+    Uns64  size;            // file size
+    Bool   is64;            // whether ELFCLASS64
+} elfImage, *elfImageP;
+
+//
+// This holds batch mode state for a hart
+//
+typedef struct riscvBatchS {
+    FILE             *list;                        // batch list file
+    int               listener;                    // server socket (or -1)
+    int               client;                      // request connection (or -1)
+    vmiModelTimerP    timer;                       // test switch timer
+    memDomainP        domain;                      // physical load domain
+    memDomainP        memory;                      // external physical memory
+    riscvPageTrackerP pages;                       // pages written by test
+    Uns64             limit;                       // instructions per test
+    Bool              running;                     // test in progress
+    Bool              switching;                   // test switch scheduled
+    Uns64             tohost;                      // current tohost address
+    Uns64             begin;                       // begin_signature address
+    Uns64             end;                         // end_signature address
+    Uns32             tests;                       // tests started
+    Uns32             errors;                      // tests not run or dumped
+    Uns32             testErrors;                  // errors before current test
+    char              elf[BATCH_MAX_LINE];         // current ELF file
+    char              signature[BATCH_MAX_LINE];   // current signature file
+    char              server[BATCH_MAX_LINE];      // server socket path
+} riscvBatch;
+
+//
+// Zero page used to clear memory and zero-fill segments
+//
+static const Uns8 zeroPage[RISCV_TRACK_PAGE_BYTES];
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MEMORY TRACKING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Stop tracking writes and restore memory written by the previous test to its
+// pre-load (zero) state
+//
+static void clearMemory(riscvBatchP batch) {
+
+    riscvPageTrackerP pages = batch->pages;
+    Uns32             num   = riscvGetTrackedPageNum(pages);
+    Uns32             i;
+
+    riscvStopPageTracker(pages);
+
+    for(i=0; i<num; i++) {
+        vmirtWriteNByteDomain(
+            batch->memory, riscvGetTrackedPage(pages, i), zeroPage,
+            RISCV_TRACK_PAGE_BYTES, 0, MEM_AA_FALSE
+        );
+    }
+
+    riscvClearTrackedPages(pages);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ELF LOADING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return little-endian field of the given size from the ELF image (zero if
+// out of range)
+//
+static Uns64 getField(elfImageP elf, Uns64 offset, Uns32 bytes) {
+
+    Uns64 result = 0;
+
+    if((offset+bytes) <= elf->size) {
+        while(bytes--) {
+            result = (result<<8) | elf->data[offset+bytes];
+        }
+    }
+
+    return result;
+}
+
+//
+// Return address-sized field (whose offset depends on ELF class)
+//
+static Uns64 getAddr(elfImageP elf, Uns64 base, Uns32 off32, Uns32 off64) {
+    return elf->is64 ?
+        getField(elf, base+off64, 8) :
+        getField(elf, base+off32, 4);
+}
+
+//
+// Read the ELF file, returning True if it is a little-endian RISC-V image
+//
+static Bool readELF(elfImageP elf, const char *path) {
+
+    FILE *file = fopen(path, "rb");
+    Bool  ok   = False;
+
+    if(file) {
+
+        fseek(file, 0, SEEK_END);
+        elf->size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        elf->data = STYPE_CALLOC_N(Uns8, elf->size+1);
+
+        ok = (
+            (fread(elf->data, 1, elf->size, file)==elf->size) &&
+            (elf->size>=64) &&
+            !memcmp(elf->data, "\177ELF", 4) &&
+            (elf->data[5]==ELF_DATA_LSB) &&
+            (
+                (elf->data[4]==ELF_CLASS_32) ||
+                (elf->data[4]==ELF_CLASS_64)
+            )
+        );
+
+        // class byte is valid only once the header length has been checked
+        elf->is64 = ok && (elf->data[4]==ELF_CLASS_64);
+
+        fclose(file);
+    }
+
+    return ok;
+}
+
+//
+// Write each loadable segment to physical memory, zero-filling any part not
+// present in the file
+//
+static void loadSegments(riscvBatchP batch, elfImageP elf) {
+
+    Uns64 phoff = getAddr(elf, 0, 28, 32);
+    Uns32 phsz  = getField(elf, elf->is64 ? 54 : 42, 2);
+    Uns32 phnum = getField(elf, elf->is64 ? 56 : 44, 2);
+    Uns32 i;
+
+    for(i=0; i<phnum; i++) {
+
+        Uns64 ph     = phoff + i*phsz;
+        Uns64 offset = getAddr(elf, ph, 4,  8);
+        Uns64 paddr  = getAddr(elf, ph, 12, 24);
+        Uns64 filesz = getAddr(elf, ph, 16, 32);
+        Uns64 memsz  = getAddr(elf, ph, 20, 40);
+
+        if(getField(elf, ph, 4)!=ELF_PT_LOAD) {
+
+            // not a loadable segment
+
+        } else if((offset+filesz) > elf->size) {
+
+            vmiMessage("W", CPU_PREFIX "_BSG",
+                "%s: segment %u extends beyond end of file", batch->elf, i
+            );
+
+        } else {
+
+            Uns64 done;
+
+            vmirtWriteNByteDomain(
+                batch->domain, paddr, elf->data+offset, filesz, 0,
+                MEM_AA_FALSE
+            );
+
+            for(done=filesz; done<memsz; done+=RISCV_TRACK_PAGE_BYTES) {
+
+                Uns64 remain = memsz-done;
+                Uns32 chunk  = RISCV_TRACK_PAGE_BYTES;
+
+                if(remain<chunk) {
+                    chunk = remain;
+                }
+
+                vmirtWriteNByteDomain(
+                    batch->domain, paddr+done, zeroPage, chunk, 0,
+                    MEM_AA_FALSE
+                );
+            }
+
+            // segment pages are cleared before the next test
+            if(memsz) {
+                riscvAddTrackedPages(batch->pages, paddr, paddr+memsz-1);
+            }
+        }
+    }
+}
+
+//
+// Find the signature and tohost symbols, returning True if all are present
+//
+static Bool findSymbols(riscvBatchP batch, elfImageP elf) {
+
+    Uns64 shoff  = getAddr(elf, 0, 32, 40);
+    Uns32 shsz   = getField(elf, elf->is64 ? 58 : 46, 2);
+    Uns32 shnum  = getField(elf, elf->is64 ? 60 : 48, 2);
+    Uns32 symsz  = elf->is64 ? 24 : 16;
+    Uns32 found  = 0;
+    Uns32 i;
+
+    for(i=0; i<shnum; i++) {
+
+        Uns64 sh = shoff + i*shsz;
+
+        if(getField(elf, sh+4, 4)==ELF_SHT_SYMTAB) {
+
+            Uns64 symoff = getAddr(elf, sh, 16, 24);
+            Uns64 symnum = getAddr(elf, sh, 20, 32) / symsz;
+            Uns32 link   = getField(elf, sh + (elf->is64 ? 40 : 24), 4);
+            Uns64 strsh  = shoff + link*shsz;
+            Uns64 stroff = getAddr(elf, strsh, 16, 24);
+            Uns64 j;
+
+            for(j=0; j<symnum; j++) {
+
+                Uns64       sym   = symoff + j*symsz;
+                Uns64       name  = stroff + getField(elf, sym, 4);
+                Uns64       value = getAddr(elf, sym, 4, 8);
+                const char *str   = (const char *)elf->data+name;
+
+                if(name>=elf->size) {
+                    // invalid name
+                } else if(!strcmp(str, "begin_signature")) {
+                    batch->begin = value;
+                    found |= 1;
+                } else if(!strcmp(str, "end_signature")) {
+                    batch->end = value;
+                    found |= 2;
+                } else if(!strcmp(str, "tohost")) {
+                    batch->tohost = value;
+                    found |= 4;
+                }
+            }
+        }
+    }
+
+    return (found==7);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TEST SEQUENCING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Dump the signature of the current test
+//
+static void dumpSignature(riscvP riscv, riscvBatchP batch) {
+
+    if(
+        !riscvWriteSignature(
+            batch->domain, batch->begin, batch->end,
+            riscv->configInfo.signature_granularity, batch->signature
+        )
+    ) {
+        batch->errors++;
+    }
+}
+
+//
+// Called when the current test writes tohost: schedule the switch to the
+// next test before the next instruction
+//
+static VMI_MEM_WATCH_FN(tohostWrite) {
+
+    riscvBatchP batch = userData;
+
+    if(!batch->switching) {
+        batch->switching = True;
+        vmirtSetModelTimer(batch->timer, 1);
+    }
+}
+
+//
+// Set the current test from a batch list line or server request, returning
+// False if it is blank or a comment. Each line gives an ELF file optionally
+// followed by its signature file; by default, the signature file name
+// replaces any ".elf" suffix with ".signature.output"
+//
+static Bool parseEntry(riscvBatchP batch, char *line) {
+
+    char *elf = strtok(line, " \t\r\n");
+    char *sig = elf ? strtok(0, " \t\r\n") : 0;
+
+    if(!elf || (elf[0]=='#')) {
+
+        return False;
+
+    } else {
+
+        strcpy(batch->elf, elf);
+
+        if(sig) {
+
+            strcpy(batch->signature, sig);
+
+        } else {
+
+            char *suffix = strrchr(elf, '.');
+
+            if(suffix && !strcmp(suffix, ".elf")) {
+                *suffix = 0;
+            }
+
+            snprintf(
+                batch->signature, sizeof(batch->signature), "%s%s",
+                elf, BATCH_SIG_SUFFIX
+            );
+        }
+
+        return True;
+    }
+}
+
+#ifndef _WIN32
+
+//
+// Read one newline-terminated request line from a connection, returning
+// False if the connection is closed first
+//
+static Bool readRequest(int fd, char *line, Uns32 bytes) {
+
+    Uns32 i = 0;
+    char  c;
+
+    while(i<(bytes-1)) {
+
+        ssize_t got = read(fd, &c, 1);
+
+        if((got<0) && (errno==EINTR)) {
+            continue;
+        } else if(got<=0) {
+            return False;
+        } else if(c=='\n') {
+            break;
+        }
+
+        line[i++] = c;
+    }
+
+    line[i] = 0;
+
+    return True;
+}
+
+//
+// Send a reply line on a connection and close it
+//
+static void sendReply(int fd, const char *status, const char *detail) {
+
+    char reply[BATCH_MAX_LINE+16];
+    int  bytes = snprintf(reply, sizeof(reply), "%s %s\n", status, detail);
+
+    // no SIGPIPE if the client has gone away
+    send(fd, reply, bytes, MSG_NOSIGNAL);
+
+    close(fd);
+}
+
+//
+// Wait for the next server request, returning False when a "quit" request
+// is received or the socket fails
+//
+static Bool nextRequest(riscvBatchP batch) {
+
+    char line[BATCH_MAX_LINE];
+
+    for(;;) {
+
+        int fd = accept(batch->listener, 0, 0);
+
+        if(fd<0) {
+
+            if(errno!=EINTR) {
+                return False;
+            }
+
+        } else if(!readRequest(fd, line, sizeof(line))) {
+
+            close(fd);
+
+        } else if(!strcmp(line, "quit")) {
+
+            sendReply(fd, "OK", "quit");
+            return False;
+
+        } else if(!parseEntry(batch, line)) {
+
+            sendReply(fd, "ERROR", "empty request");
+
+        } else {
+
+            batch->client = fd;
+            return True;
+        }
+    }
+}
+
+//
+// Reply to the client of the current server request, if any
+//
+static void completeRequest(riscvBatchP batch, Bool ok) {
+
+    if(batch->client>=0) {
+        sendReply(
+            batch->client, ok ? "OK" : "ERROR",
+            ok ? batch->signature : batch->elf
+        );
+        batch->client = -1;
+    }
+}
+
+//
+// Open the server socket, returning -1 on failure
+//
+static int openListener(const char *path) {
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int                fd   = -1;
+
+    if(strlen(path) < sizeof(addr.sun_path)) {
+
+        strcpy(addr.sun_path, path);
+        unlink(path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if(
+            (fd>=0) && (
+                bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+                listen(fd, BATCH_BACKLOG)
+            )
+        ) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    return fd;
+}
+
+#else
+
+static Bool nextRequest(riscvBatchP batch) {
+    return False;
+}
+
+static void completeRequest(riscvBatchP batch, Bool ok) {
+}
+
+static int openListener(const char *path) {
+    return -1;
+}
+
+#endif
+
+//
+// Read the next batch list entry or, once the list is exhausted, wait for
+// the next server request, returning False when there are no more tests
+//
+static Bool nextEntry(riscvBatchP batch) {
+
+    char line[BATCH_MAX_LINE];
+
+    while(batch->list && fgets(line, sizeof(line), batch->list)) {
+        if(parseEntry(batch, line)) {
+            return True;
+        }
+    }
+
+    return (batch->listener>=0) && nextRequest(batch);
+}
+
+//
+// This holds the hart start state for a test
+//
+typedef struct hartStartS {
+    Uns64 entry;            // ELF entry address
+    Bool  reset;            // whether harts have run since they were reset
+} hartStart, *hartStartP;
+
+//
+// Reset a hart to the state of a separate run and start it at the test entry
+//
+static VMI_SMP_ITER_FN(startHart) {
+
+    if(vmirtGetSMPCpuType(processor)==SMP_TYPE_LEAF) {
+
+        riscvP     hart  = (riscvP)processor;
+        hartStartP start = userData;
+
+        if(start->reset) {
+
+            Flt64 ticks = 1000000 * vmirtGetMonotonicTime(processor);
+
+            // clear register files
+            memset(hart->x, 0, sizeof(hart->x));
+            memset(hart->f, 0, sizeof(hart->f));
+
+            if(hart->v) {
+                memset(hart->v, 0, (hart->configInfo.VLEN/8)*VREG_NUM);
+            }
+
+            // restart time and counters from zero
+            hart->timeWarp         = -(Uns64)ticks;
+            hart->cycleWarp        = 0;
+            hart->baseCycles       = vmirtGetICount(processor);
+            hart->baseInstructions = vmirtGetExecutedICount(processor);
+
+            // reset CSR, PMP, CLIC and CLINT state
+            riscvReset(hart);
+            riscvVMInvalidateAll(hart);
+
+            // discard code translated for the previous test
+            vmirtFlushAllDicts(processor);
+            riscvCommitRingCodeFlush(hart);
+        }
+
+        vmirtSetPC(processor, start->entry);
+    }
+}
+
+//
+// Reset all harts, memory and semihosting state and load the next test,
+// returning True if it was started
+//
+static Bool startTest(riscvP riscv, riscvBatchP batch, Bool reset) {
+
+    elfImage elf = {0};
+    Bool     ok  = readELF(&elf, batch->elf);
+
+    batch->tests++;
+    batch->testErrors = batch->errors;
+
+    if(!ok) {
+
+        vmiMessage("W", CPU_PREFIX "_BEL",
+            "%s: cannot read little-endian ELF file", batch->elf
+        );
+
+    } else if(!(ok=findSymbols(batch, &elf))) {
+
+        vmiMessage("W", CPU_PREFIX "_BSY",
+            "%s: begin_signature, end_signature or tohost symbol missing",
+            batch->elf
+        );
+
+    } else {
+
+        hartStart start = {entry:getAddr(&elf, 0, 24, 24), reset:reset};
+
+        // restore memory and semihosting state left by the previous test
+        clearMemory(batch);
+        riscvResetSemihost(riscv);
+
+        // load the image and track pages written while it runs
+        loadSegments(batch, &elf);
+        riscvStartPageTracker(batch->pages);
+
+        // reset every hart in the cluster and start it at the entry address
+        vmirtIterAllProcessors(
+            (vmiProcessorP)riscv->smpRoot, startHart, &start
+        );
+
+        // detect test completion
+        vmirtAddWriteCallback(
+            batch->domain, 0, batch->tohost, batch->tohost+7,
+            tohostWrite, batch
+        );
+
+        // fail the test if it runs beyond the instruction limit
+        if(batch->limit) {
+            vmirtSetModelTimer(batch->timer, batch->limit);
+        }
+
+        batch->running = True;
+    }
+
+    if(elf.data) {
+        STYPE_FREE(elf.data);
+    }
+
+    if(!ok) {
+        batch->errors++;
+    }
+
+    return ok;
+}
+
+//
+// Start the next test that can be loaded, returning False when there are no
+// more tests
+//
+static Bool nextTest(riscvP riscv, riscvBatchP batch, Bool reset) {
+
+    while(nextEntry(batch)) {
+        if(startTest(riscv, batch, reset)) {
+            return True;
+        } else {
+            completeRequest(batch, False);
+        }
+    }
+
+    return False;
+}
+
+//
+// Complete the current test (if any) and start the next one, terminating
+// simulation when the list is exhausted. A test that has not written tohost
+// when this is called has reached the instruction limit and fails
+//
+static VMI_ICOUNT_FN(switchTest) {
+
+    riscvP      riscv = (riscvP)processor;
+    riscvBatchP batch = riscv->batch;
+
+    // complete the current test
+    if(batch->running) {
+
+        if(batch->switching) {
+
+            dumpSignature(riscv, batch);
+
+        } else {
+
+            vmiMessage("W", CPU_PREFIX "_BTL",
+                "%s: tohost not written within "FMT_64u" instructions",
+                batch->elf, batch->limit
+            );
+
+            batch->errors++;
+        }
+
+        completeRequest(batch, batch->errors==batch->testErrors);
+
+        vmirtRemoveWriteCallback(
+            batch->domain, 0, batch->tohost, batch->tohost+7,
+            tohostWrite, batch
+        );
+
+        batch->running   = False;
+        batch->switching = False;
+    }
+
+    if(!nextTest(riscv, batch, True)) {
+
+        vmiMessage("I", CPU_PREFIX "_BDN",
+            "Batch complete: %u tests, %u errors", batch->tests, batch->errors
+        );
+
+        vmirtFinish(batch->errors ? 1 : 0);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR AND DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Open batch list and server socket if batch mode is enabled, failing any
+// test that does not write tohost within the given number of instructions
+// (if non-zero)
+//
+void riscvNewBatch(
+    riscvP      riscv,
+    const char *batchList,
+    const char *server,
+    Uns64       limit
+) {
+
+    Bool  useList   = batchList && batchList[0];
+    Bool  useServer = server && server[0];
+    FILE *list      = 0;
+    int   listener  = -1;
+
+    if(!useList && !useServer) {
+
+        // batch mode not enabled
+
+    } else if(useList && !(list=fopen(batchList, "r"))) {
+
+        vmiMessage("E", CPU_PREFIX "_BLO",
+            "Cannot open batch list %s", batchList
+        );
+
+    } else if(useServer && ((listener=openListener(server))<0)) {
+
+        vmiMessage("E", CPU_PREFIX "_BSO",
+            "Cannot listen on UNIX socket %s", server
+        );
+
+        if(list) {
+            fclose(list);
+        }
+
+    } else {
+
+        riscvBatchP batch = STYPE_CALLOC(riscvBatch);
+
+        batch->list     = list;
+        batch->listener = listener;
+        batch->client   = -1;
+        batch->limit    = limit;
+        batch->timer    = vmirtCreateModelTimer(
+            (vmiProcessorP)riscv, switchTest, 1, 0
+        );
+
+        if(useServer) {
+            strncpy(batch->server, server, sizeof(batch->server)-1);
+        }
+
+        riscv->batch = batch;
+    }
+}
+
+//
+// Load the first test once physical memory domains exist, so that it starts
+// with the first instruction executed, tracking pages written in the given
+// external physical memory domain; if no test can be started, simulation ends
+// before the first instruction completes
+//
+void riscvStartBatch(riscvP riscv, memDomainP memory) {
+
+    riscvBatchP batch = riscv->batch;
+
+    if(batch) {
+
+        batch->domain = riscv->physDomains[RISCV_MODE_M][0];
+        batch->memory = memory;
+        batch->pages  = riscvNewPageTracker(memory);
+
+        // harts are already in their reset state
+        if(!nextTest(riscv, batch, False)) {
+            vmirtSetModelTimer(batch->timer, 1);
+        }
+    }
+}
+
+//
+// Free batch mode data structures
+//
+void riscvFreeBatch(riscvP riscv) {
+
+    riscvBatchP batch = riscv->batch;
+
+    if(batch) {
+
+        vmirtDeleteModelTimer(batch->timer);
+
+        if(batch->list) {
+            fclose(batch->list);
+        }
+
+#ifndef _WIN32
+        // fail any request in progress and remove the server socket
+        completeRequest(batch, False);
+
+        if(batch->listener>=0) {
+            close(batch->listener);
+            unlink(batch->server);
+        }
+#endif
+
+        if(batch->pages) {
+            riscvFreePageTracker(batch->pages);
+        }
+
+        STYPE_FREE(batch);
+
+        riscv->batch = 0;
+    }
+}
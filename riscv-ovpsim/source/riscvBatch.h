@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Open batch list and server socket if batch mode is enabled, failing any
+// test that does not write tohost within the given number of instructions
+// (if non-zero)
+//
+void riscvNewBatch(
+    riscvP      riscv,
+    const char *batchList,
+    const char *server,
+    Uns64       limit
+);
+
+//
+// Load the first test once physical memory domains exist, tracking pages
+// written in the given external physical memory domain
+//
+void riscvStartBatch(riscvP riscv, memDomainP memory);
+
+//
+// Free batch mode data structures
+//
+void riscvFreeBatch(riscvP riscv);
+
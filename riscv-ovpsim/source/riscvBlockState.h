@@ -62,6 +62,15 @@ typedef enum riscvVLClassE {
     VLCLASSMT_MAX     = 3,
 } riscvVLClassMt;
 
+//
+// This holds precomputed information for a single vtype encoding
+//
+typedef struct riscvVTypeInfoS {
+    riscvSEWMt       SEW;           // SEW (SEWMT_UNKNOWN if vtype is illegal)
+    Uns32            VLMAX;         // maximum vector length
+    Uns16            pmKey;         // vtype component of polymorphic key
+} riscvVTypeInfo;
+
 //
 // This indicates the VLMUL for which a vector register is known to have top
 // zero (either a single register, or a component of a group)
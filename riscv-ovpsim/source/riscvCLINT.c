@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvCLINT.h"
+#include "riscvCSR.h"
+#include "riscvExceptions.h"
+#include "riscvMessage.h"
+#include "riscvModelCallbacks.h"
+#include "riscvStructure.h"
+#include "riscvTypeRefs.h"
+
+
+//
+// CLINT register block layout (SiFive-compatible)
+//
+#define CLINT_MSIP_OFFSET       0x0000
+#define CLINT_MTIMECMP_OFFSET   0x4000
+#define CLINT_MTIME_OFFSET      0xBFF8
+#define CLINT_SIZE              0x10000
+
+//
+// Interrupt indices driven by the CLINT
+//
+#define CLINT_MSI_INDEX (riscv_E_MSWInterrupt-riscv_E_Interrupt)
+#define CLINT_MTI_INDEX (riscv_E_MTimerInterrupt-riscv_E_Interrupt)
+
+//
+// Maximum cycle delay used when arming the mtimecmp expiry timer
+//
+#define CLINT_MAX_DELAY (1ULL<<62)
+
+//
+// Return the number of harts in the cluster
+//
+inline static Uns32 getNumHarts(riscvP root) {
+    return root->numHarts ? : 1;
+}
+
+//
+// Return the base address of the cluster CLINT block
+//
+inline static Uns64 getCLINTLow(riscvP root) {
+    return root->configInfo.CLINT_address;
+}
+
+//
+// Return the indexed hart, or NULL if the index is out of range
+//
+static riscvP getCLINTHart(riscvP root, Uns32 index) {
+    return (index<getNumHarts(root)) ? root->CLINTHarts[index] : 0;
+}
+
+//
+// Return the current CLINT time (the same for all harts in a cluster)
+//
+static Uns64 getCLINTTime(riscvP root) {
+    return riscvGetTime(getCLINTHart(root, 0));
+}
+
+//
+// Return the number of instructions the hart counts before time reaches the
+// given value. Time is derived from the monotonic time of the hart, which
+// advances at its nominal instruction rate, so the result is the first count
+// at which the time is at least the given value
+//
+static Uns64 getCyclesToTime(riscvP riscv, Uns64 time) {
+
+    vmiProcessorP processor = (vmiProcessorP)riscv;
+    Flt64         ips       = vmirtGetProcessorIPS(processor);
+    Flt64         now       = vmirtGetMonotonicTime(processor);
+    Flt64         due       = (time-riscv->timeWarp)/1000000.0;
+    Flt64         cycles    = (due-now)*ips;
+    Uns64         result;
+
+    if(cycles<1) {
+        result = 1;
+    } else if(cycles>CLINT_MAX_DELAY) {
+        result = CLINT_MAX_DELAY;
+    } else if((result=cycles)<cycles) {
+        result++;
+    }
+
+    return result;
+}
+
+//
+// Refresh CLINT timer interrupt and expiry timer for the hart
+//
+void riscvUpdateCLINT(riscvP riscv) {
+
+    if(riscv->mtimecmpTimer) {
+
+        Uns64 now     = riscvGetTime(riscv);
+        Bool  expired = (now>=riscv->mtimecmp);
+
+        // update timer interrupt input
+        riscvUpdateInterruptInput(riscv, CLINT_MTI_INDEX, expired);
+
+        // arm the timer to expire when time reaches mtimecmp
+        if(expired) {
+            vmirtClearModelTimer(riscv->mtimecmpTimer);
+        } else {
+            Uns64 cycles = getCyclesToTime(riscv, riscv->mtimecmp);
+            vmirtSetModelTimer(riscv->mtimecmpTimer, cycles);
+        }
+    }
+}
+
+//
+// Callback when time reaches mtimecmp (the timer is rearmed if floating point
+// rounding made it expire one instruction early)
+//
+static VMI_ICOUNT_FN(mtimecmpExpired) {
+    riscvUpdateCLINT((riscvP)processor);
+}
+
+//
+// Update msip for the hart
+//
+static void updateMSIP(riscvP riscv, Bool msip) {
+
+    riscv->msip = msip;
+
+    riscvUpdateInterruptInput(riscv, CLINT_MSI_INDEX, msip);
+}
+
+//
+// Return the time at which the CLINT timer interrupt of the hart will next
+// become pending (or RISCV_NO_WAKE_TIME if not known)
+//
+Uns64 riscvGetCLINTWakeTime(riscvP riscv) {
+    return riscv->mtimecmpTimer ? riscv->mtimecmp : RISCV_NO_WAKE_TIME;
+}
+
+//
+// Emit debug for CLINT region access
+//
+static void debugCLINTAccess(Uns32 offset, const char *access) {
+    vmiPrintf("CLINT %s offset=0x%x\n", access, offset);
+}
+
+//
+// Read one byte from the CLINT
+//
+static Uns8 readCLINTInt(riscvP root, Uns32 offset) {
+
+    Uns64  result = 0;
+    Uns32  byte   = 0;
+    riscvP hart;
+
+    // debug access if required
+    if(RISCV_DEBUG_EXCEPT(root)) {
+        debugCLINTAccess(offset, "READ");
+    }
+
+    if(offset>=CLINT_MTIME_OFFSET+8) {
+
+        // reserved space above mtime reads as zero
+
+    } else if(offset>=CLINT_MTIME_OFFSET) {
+
+        // mtime register
+        result = getCLINTTime(root);
+        byte   = offset-CLINT_MTIME_OFFSET;
+
+    } else if(offset>=CLINT_MTIMECMP_OFFSET) {
+
+        // mtimecmp register
+        if((hart=getCLINTHart(root, (offset-CLINT_MTIMECMP_OFFSET)/8))) {
+            result = hart->mtimecmp;
+            byte   = offset%8;
+        }
+
+    } else if((hart=getCLINTHart(root, (offset-CLINT_MSIP_OFFSET)/4))) {
+
+        // msip register
+        result = hart->msip;
+        byte   = offset%4;
+    }
+
+    // extract byte from result
+    return result >> (byte*8);
+}
+
+//
+// Write one byte to the CLINT, returning the hart whose mtimecmp register
+// was written (if any)
+//
+static riscvP writeCLINTInt(riscvP root, Uns32 offset, Uns8 newValue) {
+
+    riscvP hart;
+    riscvP updated = 0;
+
+    // debug access if required
+    if(RISCV_DEBUG_EXCEPT(root)) {
+        debugCLINTAccess(offset, "WRITE");
+    }
+
+    if(offset>=CLINT_MTIME_OFFSET+8) {
+
+        // reserved space above mtime ignores writes
+
+    } else if(offset>=CLINT_MTIME_OFFSET) {
+
+        // mtime register is read-only
+
+    } else if(offset>=CLINT_MTIMECMP_OFFSET) {
+
+        // mtimecmp register
+        if((hart=getCLINTHart(root, (offset-CLINT_MTIMECMP_OFFSET)/8))) {
+
+            Uns32 shift = (offset%8)*8;
+            Uns64 mask  = 0xffULL << shift;
+            Uns64 value = (Uns64)newValue << shift;
+
+            hart->mtimecmp = (hart->mtimecmp & ~mask) | value;
+
+            updated = hart;
+        }
+
+    } else if((hart=getCLINTHart(root, (offset-CLINT_MSIP_OFFSET)/4))) {
+
+        // msip register (only bit 0 is writable)
+        if(!(offset%4)) {
+            updateMSIP(hart, newValue&1);
+        }
+    }
+
+    return updated;
+}
+
+//
+// Read CLINT register
+//
+static VMI_MEM_READ_FN(readCLINT) {
+
+    riscvP root    = userData;
+    Uns8  *value8  = value;
+    Uns64  lowAddr = getCLINTLow(root);
+    Uns32  i;
+
+    for(i=0; i<bytes; i++) {
+        value8[i] = readCLINTInt(root, address+i-lowAddr);
+    }
+}
+
+//
+// Write CLINT register
+//
+static VMI_MEM_WRITE_FN(writeCLINT) {
+
+    riscvP      root    = userData;
+    const Uns8 *value8  = value;
+    Uns64       lowAddr = getCLINTLow(root);
+    riscvP      pending = 0;
+    Uns32       i;
+
+    // compare each mtimecmp register written only once all bytes of it in
+    // this access are written, so that no partial value is seen
+    for(i=0; i<bytes; i++) {
+
+        riscvP hart = writeCLINTInt(root, address+i-lowAddr, value8[i]);
+
+        if(pending && (pending!=hart)) {
+            riscvUpdateCLINT(pending);
+        }
+
+        pending = hart;
+    }
+
+    if(pending) {
+        riscvUpdateCLINT(pending);
+    }
+}
+
+//
+// Create CLINT memory-mapped block
+//
+void riscvMapCLINTDomain(riscvP root, memDomainP CLINTDomain) {
+
+    Uns64 lowAddr  = getCLINTLow(root);
+    Uns64 highAddr = lowAddr+CLINT_SIZE-1;
+
+    // install callbacks to implement the CLINT
+    vmirtMapCallbacks(
+        CLINTDomain, lowAddr, highAddr, readCLINT, writeCLINT, root
+    );
+}
+
+//
+// Allocate CLINT data structures
+//
+void riscvNewCLINT(riscvP riscv, Uns32 index) {
+
+    riscvP  root     = riscv->smpRoot;
+    riscvPP table    = root->CLINTHarts;
+    Uns32   numHarts = getNumHarts(root);
+
+    // allocate hart table when first leaf hart is encountered
+    if(!table) {
+        table = root->CLINTHarts = STYPE_CALLOC_N(riscvP, numHarts);
+    }
+
+    // sanity check hart index and table
+    VMI_ASSERT(
+        index<numHarts,
+        "illegal hart index %u (maximum %u)",
+        index, numHarts
+    );
+    VMI_ASSERT(
+        !table[index],
+        "table entry %u already filled",
+        index
+    );
+
+    // insert this hart in the lookup table
+    table[index] = riscv;
+
+    // create timer used to signal mtimecmp expiry
+    riscv->mtimecmpTimer = vmirtCreateModelTimer(
+        (vmiProcessorP)riscv, mtimecmpExpired, 1, 0
+    );
+}
+
+//
+// Free CLINT data structures
+//
+void riscvFreeCLINT(riscvP riscv) {
+
+    if(riscv->CLINTHarts) {
+        STYPE_FREE(riscv->CLINTHarts);
+        riscv->CLINTHarts = 0;
+    }
+
+    if(riscv->mtimecmpTimer) {
+        vmirtDeleteModelTimer(riscv->mtimecmpTimer);
+        riscv->mtimecmpTimer = 0;
+    }
+}
+
+//
+// Reset CLINT
+//
+void riscvResetCLINT(riscvP riscv) {
+
+    if(riscv->mtimecmpTimer) {
+
+        // mtimecmp resets to the maximum value so no interrupt is pending
+        riscv->mtimecmp = -1;
+
+        updateMSIP(riscv, False);
+        riscvUpdateCLINT(riscv);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SAVE/RESTORE SUPPORT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Save CLINT state not covered by register read/write API
+//
+void riscvSaveCLINT(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+) {
+    VMIRT_SAVE_FIELD(cxt, riscv, mtimecmp);
+    VMIRT_SAVE_FIELD(cxt, riscv, msip);
+}
+
+//
+// Restore CLINT state not covered by register read/write API
+//
+void riscvRestoreCLINT(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+) {
+    VMIRT_RESTORE_FIELD(cxt, riscv, mtimecmp);
+    VMIRT_RESTORE_FIELD(cxt, riscv, msip);
+
+    // refresh interrupt state and rearm the expiry timer
+    updateMSIP(riscv, riscv->msip);
+    riscvUpdateCLINT(riscv);
+}
+
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Create CLINT memory-mapped block
+//
+void riscvMapCLINTDomain(riscvP root, memDomainP CLINTDomain);
+
+//
+// Allocate CLINT data structures
+//
+void riscvNewCLINT(riscvP riscv, Uns32 index);
+
+//
+// Free CLINT data structures
+//
+void riscvFreeCLINT(riscvP riscv);
+
+//
+// Reset CLINT
+//
+void riscvResetCLINT(riscvP riscv);
+
+//
+// Refresh CLINT timer interrupt and expiry timer for the hart
+//
+void riscvUpdateCLINT(riscvP riscv);
+
+//
+// Return the time at which the CLINT timer interrupt of the hart will next
+// become pending (or RISCV_NO_WAKE_TIME if not known)
+//
+Uns64 riscvGetCLINTWakeTime(riscvP riscv);
+
+//
+// Save CLINT state not covered by register read/write API
+//
+void riscvSaveCLINT(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+);
+
+//
+// Restore CLINT state not covered by register read/write API
+//
+void riscvRestoreCLINT(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+);
+
@@ -32,6 +32,7 @@
 // model header files
 #include "riscvBus.h"
 #include "riscvCLIC.h"
+#include "riscvCommitRing.h"
 #include "riscvCSR.h"
 #include "riscvCSRTypes.h"
 #include "riscvExceptions.h"
@@ -215,6 +216,7 @@ static vmiFPRC updateCurrentRMValid(riscvP riscv) {
         if(!riscv->rmCheckValid) {
             riscv->rmCheckValid = True;
             vmirtFlushAllDicts(processor);
+            riscvCommitRingCodeFlush(riscv);
         }
 
         // update state to reflect invalid RM change
@@ -575,14 +577,15 @@ static void updateEndian(riscvP riscv) {
     if(!riscv->checkEndian) {
         riscv->checkEndian = True;
         vmirtFlushAllDicts(processor);
+        riscvCommitRingCodeFlush(riscv);
     }
 }
 
 //
 // Common routine to perform actions after a status register has been written
-// (including vsstatus)
+// (including vsstatus, indicated by V)
 //
-static void postStatusW(riscvP riscv, Uns64 oldValue, Uns64 newValue) {
+static void postStatusW(riscvP riscv, Uns64 oldValue, Uns64 newValue, Bool V) {
 
     // detect any change in IE and BE bits
     Uns32 oldIE = oldValue & WM_mstatus_IE;
@@ -601,6 +604,11 @@ static void postStatusW(riscvP riscv, Uns64 oldValue, Uns64 newValue) {
     // changes in status.MPRV affect current data domain
     riscvVMRefreshMPRVDomain(riscv);
 
+    // record any change to global interrupt enables
+    if(oldIE!=newIE) {
+        riscvUpdateInterruptEnable(riscv, oldIE^newIE, V);
+    }
+
     // handle any exceptions that have been enabled
     if(newIE & ~oldIE) {
         riscvTestInterrupt(riscv);
@@ -648,7 +656,7 @@ static void statusW(riscvP riscv, Uns64 newValue, Uns64 mask) {
     }
 
     // do common actions after status register update
-    postStatusW(riscv, oldValue, newValue);
+    postStatusW(riscv, oldValue, newValue, False);
 }
 
 //
@@ -828,7 +836,7 @@ static RISCV_CSR_WRITEFN(vsstatusW) {
     WR_CSR(riscv, vsstatus, newValue);
 
     // do common actions after status register update
-    postStatusW(riscv, oldValue, newValue);
+    postStatusW(riscv, oldValue, newValue, True);
 
     // return written value
     return newValue;
@@ -1177,6 +1185,7 @@ static Uns32 ieW(riscvP riscv, Uns32 newValue, Uns32 rMask, Bool useCLIC) {
 
     // update the CSR
     WR_CSR(riscv, mie, newValue);
+    riscvMarkInterruptStale(riscv, oldValue^newValue);
 
     // handle any interrupts that are now pending and enabled
     if(!useCLIC && (oldValue!=newValue)) {
@@ -1296,7 +1305,7 @@ static RISCV_CSR_WRITEFN(midelegW) {
 
     // handle any interrupts that are now pending and enabled
     if(oldValue!=newValue) {
-        riscvTestInterrupt(riscv);
+        riscvUpdateInterruptDelegation(riscv, oldValue^newValue);
     }
 
     // return written value
@@ -1319,7 +1328,7 @@ static RISCV_CSR_WRITEFN(hidelegW) {
 
     // handle any interrupts that are now pending and enabled
     if(oldValue!=newValue) {
-        riscvTestInterrupt(riscv);
+        riscvUpdateInterruptDelegation(riscv, oldValue^newValue);
     }
 
     // return written value
@@ -1342,7 +1351,7 @@ static RISCV_CSR_WRITEFN(sidelegW) {
 
     // handle any interrupts that are now pending and enabled
     if(oldValue!=newValue) {
-        riscvTestInterrupt(riscv);
+        riscvUpdateInterruptDelegation(riscv, oldValue^newValue);
     }
 
     // return written value
@@ -1912,6 +1921,7 @@ static Uns64 tvecW(riscvP riscv, Uns64 newValue, Uns64 oldValue, Uns64 mask) {
         }                                                   \
                                                             \
         /* handle interrupts that are now pending */        \
+        riscvMarkInterruptStale(_P, -1);                    \
         riscvUpdatePending(_P);                             \
     }                                                       \
 }
@@ -2109,7 +2119,7 @@ inline static Uns64 getXLENValue(riscvP riscv, Uns64 result) {
 //
 static Uns64 getCycles(riscvP riscv) {
 
-    Uns64 result = vmirtGetICount((vmiProcessorP)riscv);
+    Uns64 result = vmirtGetICount((vmiProcessorP)riscv) + riscv->cycleWarp;
 
     // exclude the current instruction if this is a true access
     if(!riscv->artifactAccess) {
@@ -2247,12 +2257,38 @@ static RISCV_CSR_WRITEFN(mcyclehW) {
     return newValue;
 }
 
+//
+// Return current time, excluding any virtual mode delta
+//
+Uns64 riscvGetTime(riscvP riscv) {
+
+    Uns64 result = 1000000 * vmirtGetMonotonicTime((vmiProcessorP)riscv);
+
+    return result + riscv->timeWarp;
+}
+
+//
+// Advance time and cycle count by the given number of time ticks when idle
+// time is skipped, advancing the cycle count at the average rate observed so far
+//
+void riscvWarpTime(riscvP riscv, Uns64 delta) {
+
+    vmiProcessorP processor = (vmiProcessorP)riscv;
+    Flt64         ticks     = 1000000 * vmirtGetMonotonicTime(processor);
+
+    if(ticks) {
+        riscv->cycleWarp += delta * (vmirtGetICount(processor)/ticks);
+    }
+
+    riscv->timeWarp += delta;
+}
+
 //
 // Common routine to read time
 //
 static Uns64 timeR(riscvP riscv) {
 
-    Uns64 result = 1000000 * vmirtGetMonotonicTime((vmiProcessorP)riscv);
+    Uns64 result = riscvGetTime(riscv);
 
     // apply time delta in virtual mode (NOTE: use 64-bit CSR view because when
     // RV32 state, htimedeltah is mapped to top half of this)
@@ -5196,6 +5232,8 @@ void riscvCSRSave(
             // end of individual core
             VMIRT_SAVE_FIELD(cxt, riscv, baseCycles);
             VMIRT_SAVE_FIELD(cxt, riscv, baseInstructions);
+            VMIRT_SAVE_FIELD(cxt, riscv, timeWarp);
+            VMIRT_SAVE_FIELD(cxt, riscv, cycleWarp);
 
             // read-only vector register state requires explicit save
             if(riscv->configInfo.arch & ISA_V) {
@@ -5244,6 +5282,8 @@ void riscvCSRRestore(
             // end of individual core
             VMIRT_RESTORE_FIELD(cxt, riscv, baseCycles);
             VMIRT_RESTORE_FIELD(cxt, riscv, baseInstructions);
+            VMIRT_RESTORE_FIELD(cxt, riscv, timeWarp);
+            VMIRT_RESTORE_FIELD(cxt, riscv, cycleWarp);
 
             // read-only vector register state requires explicit restore
             if(riscv->configInfo.arch & ISA_V) {
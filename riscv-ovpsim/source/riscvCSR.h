@@ -429,6 +429,16 @@ void riscvPostInhibit(riscvP riscv, riscvCountStateP state, Bool preIncrement);
 //
 Bool riscvInhibitCycle(riscvP riscv);
 
+//
+// Return current time, excluding any virtual mode delta
+//
+Uns64 riscvGetTime(riscvP riscv);
+
+//
+// Advance time and cycle count by the given number of time ticks
+//
+void riscvWarpTime(riscvP riscv, Uns64 delta);
+
 //
 // Is retired instruction count inhibited?
 //
@@ -661,6 +671,9 @@ typedef CSR_REG_TYPE(status) CSR_REG_TYPE(vsstatus);
 #define WM_mstatus_TSR  (1<<22)
 #define WM_mstatus_VS_8 (3<<23)
 #define WM_mstatus_VS_9 (3<<9)
+#define WM_mstatus_UIE  (1<<0)
+#define WM_mstatus_SIE  (1<<1)
+#define WM_mstatus_MIE  (1<<3)
 #define WM_mstatus_IE   0xf
 #define WM_mstatus_UBE  (1<<6)
 #define WM_mstatus_SBE  (1ULL<<36)
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Standard header files
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvCheckpoint.h"
+#include "riscvMessage.h"
+#include "riscvPageTracker.h"
+#include "riscvRunProfile.h"
+#include "riscvSignature.h"
+#include "riscvStructure.h"
+
+
+//
+// Save/restore field keys
+//
+#define RV_DELTA_SEQUENCE   "delta.sequence"
+#define RV_DELTA_BASE       "delta.base"
+#define RV_DELTA_PAGE       "DELTA_PAGE"
+#define RV_DELTA_END        "DELTA_END"
+
+//
+// This holds the contents of one dirty page in a delta checkpoint
+//
+typedef struct deltaPageS {
+    Uns64 address;                          // page base address
+    Uns8  data[RISCV_TRACK_PAGE_BYTES];     // page contents
+} deltaPage;
+
+//
+// This holds dirty page state for a cluster
+//
+typedef struct riscvDeltaCPS {
+    memDomainP        domain;   // tracked physical data domain
+    Uns64             sequence; // sequence number of the last checkpoint
+    riscvPageTrackerP dirty;    // pages dirtied since the last checkpoint
+} riscvDeltaCP;
+
+//
+// Start tracking writes to the whole domain with an empty dirty page list
+//
+static void restartTracking(riscvDeltaCPP delta) {
+    riscvClearTrackedPages(delta->dirty);
+    riscvStartPageTracker(delta->dirty);
+}
+
+//
+// Install dirty page tracking on the cluster physical data domain if delta
+// checkpoints are enabled
+//
+void riscvNewDeltaCheckpoint(riscvP riscv, memDomainP dataDomain) {
+
+    riscvP root = riscv->smpRoot;
+
+    // physical memory is shared by all harts in a cluster
+    if(riscv->configInfo.delta_checkpoint && !root->deltaCP) {
+
+        riscvDeltaCPP delta = STYPE_CALLOC(riscvDeltaCP);
+
+        delta->domain = dataDomain;
+        delta->dirty  = riscvNewPageTracker(dataDomain);
+
+        restartTracking(delta);
+
+        root->deltaCP = delta;
+    }
+}
+
+//
+// Free delta checkpoint data structures
+//
+void riscvFreeDeltaCheckpoint(riscvP riscv) {
+
+    riscvDeltaCPP delta = riscv->deltaCP;
+
+    if(delta) {
+
+        riscvFreePageTracker(delta->dirty);
+
+        STYPE_FREE(delta);
+
+        riscv->deltaCP = 0;
+    }
+}
+
+//
+// Save pages dirtied since the previous checkpoint
+//
+void riscvDeltaCheckpointSave(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+) {
+    riscvDeltaCPP delta = riscv->deltaCP;
+
+    if(delta && (phase==SRT_END)) {
+
+        Uns64     base = delta->sequence++;
+        Uns32     num  = riscvGetTrackedPageNum(delta->dirty);
+        deltaPage entry;
+        Uns32     i;
+
+        // save position of this delta in the checkpoint chain
+        vmirtSave(cxt, RV_DELTA_BASE, &base, sizeof(base));
+        VMIRT_SAVE_FIELD(cxt, delta, sequence);
+
+        // save each dirty page
+        for(i=0; i<num; i++) {
+
+            entry.address = riscvGetTrackedPage(delta->dirty, i);
+
+            vmirtReadNByteDomain(
+                delta->domain, entry.address, entry.data,
+                RISCV_TRACK_PAGE_BYTES, 0, MEM_AA_FALSE
+            );
+
+            vmirtSaveElement(
+                cxt, RV_DELTA_PAGE, RV_DELTA_END, &entry, sizeof(entry)
+            );
+        }
+
+        // save terminator
+        vmirtSaveElement(cxt, RV_DELTA_PAGE, RV_DELTA_END, 0, 0);
+
+        // start a new delta
+        restartTracking(delta);
+    }
+}
+
+//
+// Restore pages saved in a delta checkpoint
+//
+void riscvDeltaCheckpointRestore(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+) {
+    riscvDeltaCPP delta = riscv->deltaCP;
+
+    if(delta && (phase==SRT_END)) {
+
+        Uns64     base;
+        deltaPage entry;
+
+        // restore position of this delta in the checkpoint chain
+        vmirtRestore(cxt, RV_DELTA_BASE, &base, sizeof(base));
+
+        // warn if the delta does not follow the current state
+        if(base!=delta->sequence) {
+            vmiMessage("W", CPU_PREFIX "_DCO",
+                "Delta checkpoint "FMT_64u" applied to state at checkpoint "
+                FMT_64u" (expected "FMT_64u")",
+                base+1, delta->sequence, base
+            );
+        }
+
+        VMIRT_RESTORE_FIELD(cxt, delta, sequence);
+
+        // restore each dirty page
+        while(
+            vmirtRestoreElement(
+                cxt, RV_DELTA_PAGE, RV_DELTA_END, &entry, sizeof(entry)
+            ) == SRS_OK
+        ) {
+            vmirtWriteNByteDomain(
+                delta->domain, entry.address, entry.data,
+                RISCV_TRACK_PAGE_BYTES, 0, MEM_AA_FALSE
+            );
+        }
+
+        // restored state is the base for the next delta
+        restartTracking(delta);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RESTORE AND FAN-OUT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Wait for one fan-out child to complete, returning True if it failed
+//
+static Bool waitFanOutChild(void) {
+
+#ifndef _WIN32
+    int status;
+
+    if(wait(&status)<0) {
+        return True;
+    } else {
+        return !WIFEXITED(status) || WEXITSTATUS(status);
+    }
+#else
+    return True;
+#endif
+}
+
+//
+// Write the fan-out index to guest memory so that the restored software can
+// select its payload
+//
+static void writeFanOutIndex(riscvP riscv, Uns32 index) {
+
+    Uns64 address = riscv->configInfo.fork_index_address;
+
+    if(address) {
+
+        memDomainP domain = riscv->physDomains[RISCV_MODE_M][0];
+
+        vmirtWriteNByteDomain(
+            domain, address, &index, sizeof(index), 0, MEM_AA_FALSE
+        );
+    }
+}
+
+//
+// Return the number of threads in this process, or 0 if it is not known
+//
+static Uns32 countThreads(void) {
+
+    Uns32 threads = 0;
+
+#ifdef __linux__
+    FILE *file = fopen("/proc/self/status", "r");
+    char  line[256];
+
+    if(file) {
+
+        while(!threads && fgets(line, sizeof(line), file)) {
+            sscanf(line, "Threads: %u", &threads);
+        }
+
+        fclose(file);
+    }
+#endif
+
+    return threads;
+}
+
+//
+// Return True if fan-out can proceed: fork copies only the calling thread, so
+// the simulator must be single-threaded, and the commit ring has a single
+// consumer so cannot be shared by children
+//
+static Bool checkFanOut(riscvP riscv) {
+
+    Uns32 threads = countThreads();
+
+    if(threads>1) {
+
+        vmiMessage("E", CPU_PREFIX "_FKT",
+            "Fan-out after restore requires a single simulator thread "
+            "(%u running)", threads
+        );
+
+        return False;
+
+    } else if(riscv->commitRing) {
+
+        vmiMessage("E", CPU_PREFIX "_FKC",
+            "Fan-out after restore cannot be used with commit_ring"
+        );
+
+        return False;
+
+    } else {
+
+        return True;
+    }
+}
+
+#ifndef _WIN32
+
+//
+// Prepare a fan-out child: redirect its standard output and error, give its
+// signature and run profile files distinct names and select its payload
+//
+static void startFanOutChild(riscvP riscv, Uns32 index) {
+
+    char *path = STYPE_CALLOC_N(char, strlen(riscv->forkLog)+12);
+
+    sprintf(path, "%s.%u", riscv->forkLog, index);
+
+    if(freopen(path, "w", stdout)) {
+        dup2(fileno(stdout), fileno(stderr));
+    } else {
+        vmiMessage("W", CPU_PREFIX "_FKL",
+            "Cannot open fan-out child output file %s", path
+        );
+    }
+
+    STYPE_FREE(path);
+
+    riscvForkSignature(riscv, index);
+    riscvForkRunProfile(riscv, index);
+    writeFanOutIndex(riscv, index);
+}
+
+#endif
+
+//
+// Called before the first instruction after a restore: fork one child process
+// per payload index, sharing the restored state copy-on-write. Each child
+// continues simulation with its index written to guest memory and its own
+// output files; the parent waits for all children and then terminates
+// simulation, with a non-zero status if any child failed
+//
+static VMI_ICOUNT_FN(doFanOut) {
+
+    riscvP riscv  = (riscvP)processor;
+    Uns32  forks  = riscv->configInfo.fork_count;
+    Uns32  jobs   = riscv->configInfo.fork_jobs ? : forks;
+    Uns32  active = 0;
+    Uns32  failed = 0;
+#ifndef _WIN32
+    Uns32  i;
+#endif
+
+    if(!checkFanOut(riscv)) {
+
+        failed = forks;
+
+    } else {
+
+#ifndef _WIN32
+        for(i=0; i<forks; i++) {
+
+            pid_t pid;
+
+            // limit the number of concurrently-running children
+            if(active==jobs) {
+                failed += waitFanOutChild();
+                active--;
+            }
+
+            // flush buffered output so that it is not duplicated in each child
+            fflush(stdout);
+            fflush(stderr);
+
+            pid = fork();
+
+            if(!pid) {
+
+                // child: select payload and continue simulation
+                startFanOutChild(riscv, i);
+                return;
+
+            } else if(pid<0) {
+
+                vmiMessage("E", CPU_PREFIX "_FKF",
+                    "Failed to create fan-out child %u", i
+                );
+                failed++;
+
+            } else {
+
+                active++;
+            }
+        }
+#else
+        vmiMessage("E", CPU_PREFIX "_FKU",
+            "Fan-out after restore is not supported on this host"
+        );
+        failed = forks;
+#endif
+    }
+
+    // wait for remaining children
+    while(active) {
+        failed += waitFanOutChild();
+        active--;
+    }
+
+    vmiMessage("I", CPU_PREFIX "_FKS",
+        "Fan-out complete: %u children, %u failed", forks, failed
+    );
+
+    vmirtFinish(failed ? 1 : 0);
+}
+
+//
+// Allocate fan-out timer and record child output file if required
+//
+void riscvNewFanOut(riscvP riscv, const char *log) {
+
+    if(riscv->configInfo.fork_count) {
+
+        riscv->forkTimer = vmirtCreateModelTimer(
+            (vmiProcessorP)riscv, doFanOut, 1, 0
+        );
+
+        riscv->forkLog = STYPE_CALLOC_N(char, strlen(log)+1);
+        strcpy(riscv->forkLog, log);
+    }
+}
+
+//
+// Free fan-out timer and child output file name
+//
+void riscvFreeFanOut(riscvP riscv) {
+
+    if(riscv->forkTimer) {
+        vmirtDeleteModelTimer(riscv->forkTimer);
+        riscv->forkTimer = 0;
+    }
+
+    if(riscv->forkLog) {
+        STYPE_FREE(riscv->forkLog);
+        riscv->forkLog = 0;
+    }
+}
+
+//
+// Schedule fan-out before the next instruction once a restore is complete
+//
+void riscvFanOutRestore(riscvP riscv, vmiSaveRestorePhase phase) {
+
+    if((phase==SRT_END) && riscv->configInfo.fork_count) {
+
+        vmiProcessorP leaf = (vmiProcessorP)riscv;
+
+        // fan-out is initiated by the first hart in the cluster
+        while(vmirtGetSMPCpuType(leaf)!=SMP_TYPE_LEAF) {
+            leaf = vmirtGetSMPChild(leaf);
+        }
+
+        vmirtSetModelTimer(((riscvP)leaf)->forkTimer, 1);
+    }
+}
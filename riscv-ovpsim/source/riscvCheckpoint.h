@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Install dirty page tracking on the cluster physical data domain if delta
+// checkpoints are enabled
+//
+void riscvNewDeltaCheckpoint(riscvP riscv, memDomainP dataDomain);
+
+//
+// Free delta checkpoint data structures
+//
+void riscvFreeDeltaCheckpoint(riscvP riscv);
+
+//
+// Save pages dirtied since the previous checkpoint
+//
+void riscvDeltaCheckpointSave(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+);
+
+//
+// Restore pages saved in a delta checkpoint
+//
+void riscvDeltaCheckpointRestore(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+);
+
+//
+// Allocate fan-out timer and record child output file if required
+//
+void riscvNewFanOut(riscvP riscv, const char *log);
+
+//
+// Free fan-out timer and child output file name
+//
+void riscvFreeFanOut(riscvP riscv);
+
+//
+// Schedule fan-out before the next instruction once a restore is complete
+//
+void riscvFanOutRestore(riscvP riscv, vmiSaveRestorePhase phase);
+
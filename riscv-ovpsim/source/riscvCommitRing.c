@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Standard header files
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiMt.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvCommitRing.h"
+#include "riscvCSR.h"
+#include "riscvMessage.h"
+#include "riscvStructure.h"
+#include "riscvUtils.h"
+
+
+//
+// Commit ring geometry: records are published to the checker in batches of
+// COMMIT_BATCH, and the ring holds COMMIT_RECORDS records (a power of two)
+//
+#define COMMIT_MAGIC        0x31474e4952435652ULL   // "RVCRING1"
+#define COMMIT_RECORDS      65536
+#define COMMIT_BATCH        256
+#define COMMIT_WAIT_US      20
+
+//
+// Instruction descriptors are allocated in blocks of this size
+//
+#define COMMIT_DESC_BLOCK   1024
+
+//
+// Commit record flags
+//
+#define COMMIT_HAS_RD       0x1
+#define COMMIT_HAS_CSR      0x2
+
+//
+// One committed instruction, as seen by the checker (32 bytes, little-endian)
+//
+typedef struct riscvCommitRecordS {
+    Uns64 pc;                   // instruction address
+    Uns64 rdValue;              // X register value written
+    Uns64 csrValue;             // CSR value written
+    Uns32 instruction;          // instruction encoding
+    Uns8  rd;                   // X register written
+    Uns8  flags;                // COMMIT_HAS_RD, COMMIT_HAS_CSR
+    Uns16 csr;                  // CSR written
+} riscvCommitRecord, *riscvCommitRecordP;
+
+//
+// Shared ring header (64 bytes), followed by the records. The model advances
+// head and done; the checker advances tail and sets stop at a divergence
+//
+typedef struct riscvCommitHeaderS {
+    Uns64          magic;       // COMMIT_MAGIC once initialized
+    Uns32          capacity;    // ring size in records
+    Uns32          recordBytes; // size of each record
+    volatile Uns64 head;        // records published by the model
+    volatile Uns64 tail;        // records consumed by the checker
+    volatile Uns32 stop;        // checker requests end of simulation
+    volatile Uns32 done;        // model has published its last record
+    Uns8           pad[24];
+} riscvCommitHeader, *riscvCommitHeaderP;
+
+//
+// Translation-time description of an instruction
+//
+typedef struct riscvCommitDescS {
+    Uns64 pc;                   // instruction address
+    Uns64 valueMask;            // mask of XLEN bits in register values
+    Uns32 instruction;          // instruction encoding
+    Uns32 csr;                  // CSR written (if hasCSR)
+    Uns8  rd;                   // X register written (if non-zero)
+    Bool  hasCSR;               // whether a CSR is written
+} riscvCommitDesc, *riscvCommitDescP;
+
+//
+// Block of instruction descriptors
+//
+typedef struct riscvCommitDescBlockS {
+    struct riscvCommitDescBlockS *next;
+    Uns32                         used;
+    riscvCommitDesc               descs[COMMIT_DESC_BLOCK];
+} riscvCommitDescBlock, *riscvCommitDescBlockP;
+
+//
+// This holds the commit ring state for a hart
+//
+typedef struct riscvCommitRingS {
+    riscvCommitHeaderP    header;       // mapped ring header
+    riscvCommitRecordP    records;      // mapped ring records
+    Uns64                 head;         // records written (maybe unpublished)
+    riscvCommitDescP      pending;      // executing instruction to commit
+    riscvCommitDescP      morphDesc;    // instruction being translated
+    riscvCommitDesc       current;      // pending copy kept over code flush
+    riscvCommitDescBlockP blocks;       // descriptor blocks
+    Bool                  stopped;      // no more records are written
+    Bool                  ending;       // simulation is already ending
+} riscvCommitRing;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SHARED RING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Size of the shared ring file
+//
+#define COMMIT_RING_BYTES ( \
+    sizeof(riscvCommitHeader) + COMMIT_RECORDS*sizeof(riscvCommitRecord) \
+)
+
+#ifndef _WIN32
+
+//
+// Create and map the shared ring file, returning NULL on failure
+//
+static riscvCommitHeaderP openRing(const char *path) {
+
+    riscvCommitHeaderP header = 0;
+    int                fd     = open(path, O_RDWR|O_CREAT|O_TRUNC, 0666);
+
+    if(fd<0) {
+
+        // no action
+
+    } else if(ftruncate(fd, COMMIT_RING_BYTES)) {
+
+        close(fd);
+
+    } else {
+
+        void *map = mmap(
+            0, COMMIT_RING_BYTES, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0
+        );
+
+        close(fd);
+
+        if(map!=MAP_FAILED) {
+
+            header = map;
+
+            header->capacity    = COMMIT_RECORDS;
+            header->recordBytes = sizeof(riscvCommitRecord);
+
+            // the checker waits for the magic number, so write it last
+            __sync_synchronize();
+            header->magic = COMMIT_MAGIC;
+        }
+    }
+
+    return header;
+}
+
+//
+// Unmap the shared ring file
+//
+static void closeRing(riscvCommitHeaderP header) {
+    munmap(header, COMMIT_RING_BYTES);
+}
+
+//
+// Wait for the checker to consume records
+//
+static void waitRing(void) {
+    usleep(COMMIT_WAIT_US);
+}
+
+#else
+
+static riscvCommitHeaderP openRing(const char *path) {
+    return 0;
+}
+
+static void closeRing(riscvCommitHeaderP header) {
+}
+
+static void waitRing(void) {
+}
+
+#endif
+
+//
+// End simulation when the checker has found a divergence
+//
+static void stopSimulation(riscvP riscv, riscvCommitRingP ring) {
+
+    if(!ring->stopped && !ring->ending) {
+
+        vmiMessage("I", CPU_PREFIX "_CRS",
+            "Commit ring checker requested end of simulation after "
+            FMT_64u" instructions",
+            ring->head
+        );
+
+        vmirtFinish(1);
+    }
+
+    ring->stopped = True;
+}
+
+//
+// Make all written records visible to the checker
+//
+static void publishRing(riscvP riscv, riscvCommitRingP ring) {
+
+    riscvCommitHeaderP header = ring->header;
+
+    // records must be visible before the head index that covers them
+    __sync_synchronize();
+    header->head = ring->head;
+
+    if(header->stop) {
+        stopSimulation(riscv, ring);
+    }
+}
+
+//
+// Return the next free record, waiting for the checker if the ring is full,
+// or NULL if the checker has stopped
+//
+static riscvCommitRecordP reserveRecord(riscvP riscv, riscvCommitRingP ring) {
+
+    riscvCommitHeaderP header = ring->header;
+
+    if(ring->head-header->tail >= COMMIT_RECORDS) {
+
+        publishRing(riscv, ring);
+
+        while(!header->stop && (ring->head-header->tail >= COMMIT_RECORDS)) {
+            waitRing();
+        }
+
+        if(header->stop) {
+            stopSimulation(riscv, ring);
+        }
+    }
+
+    return ring->stopped ? 0 : &ring->records[ring->head%COMMIT_RECORDS];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// COMMIT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Write a record for the pending instruction, which has retired
+//
+static void commitPending(riscvP riscv, riscvCommitRingP ring) {
+
+    riscvCommitDescP   desc = ring->pending;
+    riscvCommitRecordP record;
+
+    if(desc && (record=reserveRecord(riscv, ring))) {
+
+        record->pc          = desc->pc;
+        record->instruction = desc->instruction;
+        record->rd          = desc->rd;
+        record->rdValue     = desc->rd ? riscv->x[desc->rd]&desc->valueMask : 0;
+        record->flags       = desc->rd ? COMMIT_HAS_RD : 0;
+        record->csr         = desc->csr;
+        record->csrValue    = 0;
+
+        if(desc->hasCSR) {
+
+            Bool old = riscv->artifactAccess;
+
+            // read without side effects, as a debugger would
+            riscv->artifactAccess = True;
+            record->csrValue = riscvReadCSRNum(riscv, desc->csr);
+            riscv->artifactAccess = old;
+
+            record->flags    |= COMMIT_HAS_CSR;
+            record->csrValue &= desc->valueMask;
+        }
+
+        // publish a batch of records at a time
+        if(!(++ring->head % COMMIT_BATCH)) {
+            publishRing(riscv, ring);
+        }
+    }
+
+    ring->pending = 0;
+}
+
+//
+// Called at the start of each instruction: the previous instruction has
+// retired, so commit it, and make this one pending
+//
+static void commitInstruction(riscvP riscv, riscvCommitDescP desc) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+
+    commitPending(riscv, ring);
+
+    ring->pending = desc;
+}
+
+//
+// Commit the previous instruction unless it is the one at the given
+// exception address (which did not retire)
+//
+void riscvCommitRingTrap(riscvP riscv, Uns64 epc) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+
+    if(!ring || !ring->pending) {
+        // no action
+    } else if(ring->pending->pc==epc) {
+        ring->pending = 0;
+    } else {
+        commitPending(riscv, ring);
+    }
+}
+
+//
+// Commit the previous instruction, which has retired
+//
+void riscvCommitRingFlush(riscvP riscv) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+
+    if(ring) {
+        commitPending(riscv, ring);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRANSLATION
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate a new instruction descriptor
+//
+static riscvCommitDescP newDesc(riscvCommitRingP ring) {
+
+    riscvCommitDescBlockP block = ring->blocks;
+
+    if(!block || (block->used==COMMIT_DESC_BLOCK)) {
+        block         = STYPE_CALLOC(riscvCommitDescBlock);
+        block->next   = ring->blocks;
+        ring->blocks  = block;
+    }
+
+    return &block->descs[block->used++];
+}
+
+//
+// Free all instruction descriptors
+//
+static void freeDescs(riscvCommitRingP ring) {
+
+    riscvCommitDescBlockP block;
+
+    while((block=ring->blocks)) {
+        ring->blocks = block->next;
+        STYPE_FREE(block);
+    }
+}
+
+//
+// Free the descriptors of translated code that has been discarded, keeping
+// a copy of the pending instruction so that it can still be committed
+//
+void riscvCommitRingCodeFlush(riscvP riscv) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+
+    if(ring && !ring->morphDesc) {
+
+        if(ring->pending) {
+            ring->current = *ring->pending;
+            ring->pending = &ring->current;
+        }
+
+        freeDescs(ring);
+    }
+}
+
+//
+// Emit code to commit the previous instruction to the commit ring at the
+// start of the instruction being translated
+//
+void riscvCommitRingMorph(riscvP riscv, riscvInstrInfoP info) {
+
+    riscvCommitRingP ring        = riscv->commitRing;
+    riscvCommitDescP desc        = newDesc(ring);
+    Uns32            instruction = info->instruction;
+
+    desc->pc          = info->thisPC;
+    desc->instruction = instruction;
+    desc->valueMask   = getAddressMask(riscvGetXlenMode(riscv));
+
+    // CSR instructions write the CSR unless they are CSRRS or CSRRC (or
+    // immediate forms) with a zero source field
+    if(
+        (info->bytes==4) &&
+        ((instruction & 0x7f)==0x73) &&
+        ((instruction>>12) & 3) && (
+            (((instruction>>12) & 3)==1) || ((instruction>>15) & 0x1f)
+        )
+    ) {
+        desc->hasCSR = True;
+        desc->csr    = instruction>>20;
+    }
+
+    ring->morphDesc = desc;
+
+    vmimtArgProcessor();
+    vmimtArgNatAddress(desc);
+    vmimtCall((vmiCallFn)commitInstruction);
+}
+
+//
+// Record the destination register of the instruction just translated
+//
+void riscvCommitRingMorphDone(riscvP riscv) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+    Uns32            mask = riscv->writtenXMask & ~1;
+    Uns8             rd   = 0;
+
+    while(mask && !(mask & 1)) {
+        mask >>= 1;
+        rd++;
+    }
+
+    ring->morphDesc->rd = mask ? rd : 0;
+    ring->morphDesc     = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR AND DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate commit ring data structures if a commit ring file is specified
+//
+void riscvNewCommitRing(riscvP riscv, const char *path) {
+
+    riscvCommitHeaderP header;
+
+    if(!path || !path[0]) {
+
+        // no action
+
+    } else if(!(header=openRing(path))) {
+
+        vmiMessage("E", CPU_PREFIX "_CRO",
+            "Cannot create commit ring file %s",
+            path
+        );
+
+    } else {
+
+        riscvCommitRingP ring = STYPE_CALLOC(riscvCommitRing);
+
+        ring->header  = header;
+        ring->records = (riscvCommitRecordP)(header+1);
+
+        riscv->commitRing = ring;
+    }
+}
+
+//
+// Publish all outstanding records and free commit ring data structures
+//
+void riscvFreeCommitRing(riscvP riscv) {
+
+    riscvCommitRingP ring = riscv->commitRing;
+
+    if(ring) {
+
+        // the last instruction has retired
+        ring->ending = True;
+        commitPending(riscv, ring);
+        publishRing(riscv, ring);
+        ring->header->done = 1;
+
+        closeRing(ring->header);
+        freeDescs(ring);
+
+        STYPE_FREE(ring);
+
+        riscv->commitRing = 0;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Allocate commit ring data structures if a commit ring file is specified
+//
+void riscvNewCommitRing(riscvP riscv, const char *path);
+
+//
+// Emit code to commit the previous instruction to the commit ring at the
+// start of the instruction being translated
+//
+void riscvCommitRingMorph(riscvP riscv, riscvInstrInfoP info);
+
+//
+// Record the destination register of the instruction just translated
+//
+void riscvCommitRingMorphDone(riscvP riscv);
+
+//
+// Commit the previous instruction unless it is the one at the given
+// exception address (which did not retire)
+//
+void riscvCommitRingTrap(riscvP riscv, Uns64 epc);
+
+//
+// Commit the previous instruction, which has retired
+//
+void riscvCommitRingFlush(riscvP riscv);
+
+//
+// Free the descriptors of translated code that has been discarded
+//
+void riscvCommitRingCodeFlush(riscvP riscv);
+
+//
+// Publish all outstanding records and free commit ring data structures
+//
+void riscvFreeCommitRing(riscvP riscv);
+
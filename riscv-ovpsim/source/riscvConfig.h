@@ -72,6 +72,7 @@ typedef struct riscvConfigS {
     riscvBitManipSet  bitmanip_absent;  // bitmanip absent extensions
     riscvFP16Ver      fp16_version;     // 16-bit floating point version
     riscvFSMode       mstatus_fs_mode;  // mstatus.FS update mode
+    riscvTLBSaveMode  TLB_save;         // TLB save/restore mode
     riscvDMMode       debug_mode;       // is Debug mode implemented?
     const char      **members;          // cluster member variants
 
@@ -80,6 +81,8 @@ typedef struct riscvConfigS {
     Uns64             nmi_address;      // NMI address
     Uns64             debug_address;    // debug vector address
     Uns64             dexc_address;     // debug exception address
+    Uns64             CLINT_address;    // internal CLINT base address
+    Uns64             fork_index_address;// fan-out child index address
     Uns64             unimp_int_mask;   // mask of unimplemented interrupts
     Uns64             force_mideleg;    // always-delegated M-mode interrupts
     Uns64             force_sideleg;    // always-delegated S-mode interrupts
@@ -113,6 +116,14 @@ typedef struct riscvConfigS {
     Bool              unaligned;        // whether unaligned accesses supported
     Bool              unalignedAMO;     // whether AMO supports unaligned
     Bool              wfi_is_nop;       // whether WFI is treated as NOP
+    Bool              wfi_time_warp;    // whether idle WFI time is skipped
+    Bool              trap_profile;     // whether traps are profiled
+    Bool              semihost_ebreak;  // whether EBREAK semihosting enabled
+    Bool              semihost_memops;  // whether native memory ops enabled
+    Uns32             signature_granularity; // signature word size (bytes)
+    Bool              delta_checkpoint; // whether delta checkpoints enabled
+    Uns32             fork_count;       // fan-out children after restore
+    Uns32             fork_jobs;        // concurrent fan-out children
     Bool              mtvec_is_ro;      // whether mtvec is read-only
     Bool              cycle_undefined;  // whether cycle CSR is undefined
     Bool              time_undefined;   // whether time CSR is undefined
@@ -17,6 +17,9 @@
  *
  */
 
+// Standard header files
+#include <string.h>
+
 // Imperas header files
 #include "hostapi/impAlloc.h"
 
@@ -552,6 +555,14 @@ void riscvFreeRegInfo(riscvP riscv) {
             riscv->regInfo[i] = 0;
         }
     }
+
+    if(riscv->snapLayout) {
+        STYPE_FREE(riscv->snapLayout->entries);
+        STYPE_FREE(riscv->snapLayout->data);
+        STYPE_FREE(riscv->snapLayout->text);
+        STYPE_FREE(riscv->snapLayout);
+        riscv->snapLayout = 0;
+    }
 }
 
 //
@@ -596,6 +607,200 @@ VMI_REG_IMPL_FN(riscvRegImpl) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// PACKED REGISTER SNAPSHOTS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Is the register included in a snapshot?
+//
+static Bool isSnapReg(vmiRegInfoCP reg) {
+    return (
+        (reg->group==RV_GROUP(CORE)) ||
+        (reg->group==RV_GROUP(FP))   ||
+        (reg->group==RV_GROUP(V))    ||
+        isCSRGroup(reg->group)
+    );
+}
+
+//
+// Fill snapshot entry details for the register
+//
+static void fillSnapEntry(riscvP riscv, riscvSnapEntryP entry) {
+
+    vmiRegInfoCP reg   = entry->reg;
+    Uns32        index = reg->gdbIndex;
+
+    entry->bytes = (reg->bits+7)/8;
+
+    if(isCSRGroup(reg->group)) {
+        entry->kind  = RVSK_CSR;
+    } else if(reg->usage==vmi_REG_PC) {
+        entry->kind  = RVSK_PC;
+    } else if(reg->group==RV_GROUP(CORE)) {
+        entry->kind  = RVSK_STATE;
+        entry->state = &riscv->x[index];
+    } else if(reg->group==RV_GROUP(FP)) {
+        entry->kind  = RVSK_STATE;
+        entry->state = &riscv->f[index-RISCV_FPR0_INDEX];
+    } else {
+        Uns32 vIndex = index-RISCV_V0_INDEX;
+        entry->kind  = RVSK_STATE;
+        entry->state = &riscv->v[vIndex*riscv->configInfo.VLEN/32];
+    }
+}
+
+//
+// Return the layout of a packed snapshot of all GPR, PC, FPR, vector and CSR
+// values for the hart
+//
+riscvSnapLayoutCP riscvGetSnapLayout(riscvP riscv) {
+
+    // create layout if it has not been created
+    if(!riscv->snapLayout) {
+
+        riscvSnapLayoutP layout = STYPE_CALLOC(riscvSnapLayout);
+        vmiRegInfoCP     reg    = 0;
+        Uns32            num    = 0;
+
+        // count registers in snapshot
+        while((reg=getNextRegister(riscv, reg, VMIRIT_NORMAL))) {
+            num += isSnapReg(reg);
+        }
+
+        layout->entries = STYPE_CALLOC_N(riscvSnapEntry, num);
+
+        // assign packed offsets
+        while((reg=getNextRegister(riscv, reg, VMIRIT_NORMAL))) {
+
+            if(isSnapReg(reg)) {
+
+                riscvSnapEntryP entry = &layout->entries[layout->numEntries++];
+
+                entry->reg    = reg;
+                entry->offset = layout->bytes;
+
+                fillSnapEntry(riscv, entry);
+
+                layout->bytes += entry->bytes;
+            }
+        }
+
+        // allocate command buffers (two hex digits per byte of result)
+        layout->data = STYPE_CALLOC_N(Uns8, layout->bytes);
+        layout->text = STYPE_CALLOC_N(char, layout->bytes*2+1);
+
+        riscv->snapLayout = layout;
+    }
+
+    return riscv->snapLayout;
+}
+
+//
+// Fill the buffer with a packed snapshot of all registers described by the
+// layout, returning the number of bytes written
+//
+Uns32 riscvReadSnapshot(riscvP riscv, void *buffer) {
+
+    riscvSnapLayoutCP layout = riscvGetSnapLayout(riscv);
+    Uns8             *base   = buffer;
+    Bool              old    = riscv->artifactAccess;
+    Uns32             i;
+
+    // all CSR reads are artifact accesses
+    riscv->artifactAccess = True;
+
+    for(i=0; i<layout->numEntries; i++) {
+
+        riscvSnapEntryCP entry = &layout->entries[i];
+        Uns8            *dst   = base + entry->offset;
+
+        if(entry->kind==RVSK_STATE) {
+            memcpy(dst, entry->state, entry->bytes);
+        } else if(entry->kind==RVSK_PC) {
+            readPC((vmiProcessorP)riscv, entry->reg, dst);
+        } else if(!riscvReadCSR(getCSRAttrs(entry->reg), riscv, dst)) {
+            memset(dst, 0, entry->bytes);
+        }
+    }
+
+    riscv->artifactAccess = old;
+
+    return layout->bytes;
+}
+
+//
+// Print the register snapshot layout
+//
+static VMIRT_COMMAND_PARSE_FN(snapLayoutCommand) {
+
+    riscvP            riscv  = (riscvP)processor;
+    riscvSnapLayoutCP layout = riscvGetSnapLayout(riscv);
+    Uns32             i;
+
+    vmiPrintf("register snapshot: %u bytes\n", layout->bytes);
+
+    for(i=0; i<layout->numEntries; i++) {
+
+        riscvSnapEntryCP entry = &layout->entries[i];
+
+        vmiPrintf(
+            "  %-16s offset %5u bytes %3u\n",
+            entry->reg->name, entry->offset, entry->bytes
+        );
+    }
+
+    return "1";
+}
+
+//
+// Return a packed snapshot of all registers as a hexadecimal byte string
+// (in layout order, lowest address first)
+//
+static VMIRT_COMMAND_PARSE_FN(snapshotCommand) {
+
+    static const char hex[] = "0123456789abcdef";
+
+    riscvP            riscv  = (riscvP)processor;
+    riscvSnapLayoutCP layout = riscvGetSnapLayout(riscv);
+    Uns8             *buffer = layout->data;
+    char             *text   = layout->text;
+    Uns32             bytes  = riscvReadSnapshot(riscv, buffer);
+    Uns32             i;
+
+    for(i=0; i<bytes; i++) {
+        *text++ = hex[buffer[i]>>4];
+        *text++ = hex[buffer[i]&15];
+    }
+
+    *text = 0;
+
+    return layout->text;
+}
+
+//
+// Add commands to query register snapshots
+//
+void riscvAddSnapCommands(riscvP riscv) {
+
+    vmirtAddCommandParse(
+        (vmiProcessorP)riscv,
+        "registerSnapshotLayout",
+        "show packed register snapshot layout",
+        snapLayoutCommand,
+        VMI_CT_QUERY|VMI_CA_QUERY
+    );
+
+    vmirtAddCommandParse(
+        (vmiProcessorP)riscv,
+        "registerSnapshot",
+        "return packed register snapshot as a hexadecimal string",
+        snapshotCommand,
+        VMI_CT_QUERY|VMI_CA_QUERY
+    );
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // PROCESSOR DESCRIPTION
 ////////////////////////////////////////////////////////////////////////////////
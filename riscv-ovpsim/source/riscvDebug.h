@@ -22,12 +22,63 @@
 // Imperas header files
 #include "hostapi/impTypes.h"
 
+// VMI header files
+#include "vmi/vmiTypes.h"
+
 // model header files
 #include "riscvTypeRefs.h"
 #include "riscvVariant.h"
 
+//
+// How the value of a register in a snapshot is obtained
+//
+typedef enum riscvSnapKindE {
+    RVSK_STATE,         // copied directly from model state
+    RVSK_PC,            // program counter
+    RVSK_CSR,           // CSR read using its attributes
+} riscvSnapKind;
+
+//
+// Description of one register in a packed register snapshot
+//
+typedef struct riscvSnapEntryS {
+    vmiRegInfoCP  reg;          // register description
+    Uns32         offset;       // byte offset in snapshot
+    Uns32         bytes;        // byte size in snapshot
+    riscvSnapKind kind;         // how the value is obtained
+    void         *state;        // model state (RVSK_STATE only)
+} riscvSnapEntry;
+
+//
+// Layout of a packed register snapshot
+//
+typedef struct riscvSnapLayoutS {
+    Uns32           bytes;      // total snapshot size in bytes
+    Uns32           numEntries; // number of registers in snapshot
+    riscvSnapEntryP entries;    // register descriptions
+    Uns8           *data;       // snapshot command data buffer
+    char           *text;       // snapshot command result buffer
+} riscvSnapLayout;
+
 //
 // Free register descriptions, if they have been allocated
 //
 void riscvFreeRegInfo(riscvP riscv);
 
+//
+// Return the layout of a packed snapshot of all GPR, PC, FPR, vector and CSR
+// values for the hart
+//
+riscvSnapLayoutCP riscvGetSnapLayout(riscvP riscv);
+
+//
+// Fill the buffer with a packed snapshot of all registers described by the
+// layout, returning the number of bytes written
+//
+Uns32 riscvReadSnapshot(riscvP riscv, void *buffer);
+
+//
+// Add commands to query register snapshots
+//
+void riscvAddSnapCommands(riscvP riscv);
+
@@ -444,6 +444,130 @@ void riscvDoc(riscvP rootProcessor) {
             );
         }
 
+        // document WFI time warp behavior
+        if(cfg->wfi_time_warp) {
+            vmidocAddText(
+                Features,
+                "When all harts in the cluster are halted in WFI and the time "
+                "at which an interrupt will next become pending is known, time "
+                "and cycle counts advance directly to that point. This is "
+                "enabled using parameter \"wfi_time_warp\"."
+            );
+        }
+
+        // document trap profiling
+        if(cfg->trap_profile) {
+            vmidocAddText(
+                Features,
+                "Trap profiling is enabled using parameter \"trap_profile\". "
+                "Traps are counted by cause and target mode. The number of "
+                "instructions executed between trap entry and the matching "
+                "xRET, the maximum trap nesting depth and the number of cycles "
+                "between assertion of an interrupt input and entry to its "
+                "handler are also recorded. Results are reported when the "
+                "simulation ends."
+            );
+        }
+
+        // document buffered EBREAK semihosting
+        if(cfg->semihost_ebreak) {
+            vmidocAddText(
+                Features,
+                "Buffered semihosting is enabled using parameter "
+                "\"semihost_ebreak\". An EBREAK preceded by "
+                "\"slli x0,x0,0x1f\" and followed by \"srai x0,x0,7\" "
+                "performs the semihosting operation in a0 with the parameter "
+                "block in a1 instead of taking a Breakpoint exception. "
+                "Console and file output is buffered on the host and is "
+                "flushed on SYS_EXIT, before console input is read and when "
+                "the simulation ends, so it may appear out of order with "
+                "respect to simulator messages."
+            );
+        }
+
+        // document accelerated memory operations
+        if(cfg->semihost_ebreak && cfg->semihost_memops) {
+            vmidocAddText(
+                Features,
+                "Parameter \"semihost_memops\" enables semihosting "
+                "operations 0x100 (memcpy), 0x101 (memset) and 0x102 "
+                "(memmove), each taking a parameter block of destination, "
+                "source (or fill value) and length and returning the "
+                "destination. Permissions of every page accessed are checked "
+                "(including PMP and address translation) before any data is "
+                "transferred; if an access would fault, the exception is "
+                "taken with the EBREAK as the exception PC so that the "
+                "operation is restarted when the handler returns. These "
+                "operations are not architectural: they complete without "
+                "advancing instruction counts or simulated time."
+            );
+        }
+
+        // document TLB save/restore behavior
+        if(cfg->TLB_save==RVTS_LAZY) {
+            vmidocAddText(
+                Features,
+                "TLB entries in saved state are reinserted in the TLB only "
+                "when first looked up after restore (parameter "
+                "\"TLB_save\" is \"lazy\")."
+            );
+        } else if(cfg->TLB_save==RVTS_NONE) {
+            vmidocAddText(
+                Features,
+                "TLB contents are not included in saved state, so the TLB is "
+                "empty after restore (parameter \"TLB_save\" is \"none\")."
+            );
+        }
+
+        // document delta checkpoints
+        if(cfg->delta_checkpoint) {
+            vmidocAddText(
+                Features,
+                "Delta checkpoints are enabled using parameter "
+                "\"delta_checkpoint\". Writes to physical memory are tracked "
+                "at 4KB page granularity, and each saved state includes the "
+                "contents of pages written since the previous save or "
+                "restore. Only the first write to each page between "
+                "checkpoints is intercepted. A chain of delta checkpoints "
+                "must be restored in order on top of the base state from "
+                "which it was created; a warning is issued otherwise."
+            );
+        }
+
+        // document fan-out after restore
+        if(cfg->fork_count) {
+            vmidocAddText(
+                Features,
+                "When state is restored, the simulator forks the number of "
+                "child processes given by parameter \"fork_count\" before "
+                "the next instruction is executed. Children share the "
+                "restored state copy-on-write, so the cost of the restore is "
+                "paid once. Each child writes its 32-bit index (from 0) to "
+                "the physical address given by parameter "
+                "\"fork_index_address\" and continues simulation, so that "
+                "software resident in the restored image can select a "
+                "different payload in each child. Parameter \"fork_jobs\" "
+                "limits how many children run at once. The parent process "
+                "waits for all children and then ends simulation, with a "
+                "non-zero status if any child failed. Fan-out is not "
+                "supported on Windows hosts."
+            );
+        }
+
+        // document internal CLINT
+        if(cfg->CLINT_address) {
+            vmidocAddText(
+                Features,
+                "An internal CLINT is implemented at the address given by "
+                "parameter \"CLINT_address\". It has the SiFive layout: "
+                "msip registers at offset 0x0000 (4 bytes per hart), mtimecmp "
+                "registers at offset 0x4000 (8 bytes per hart) and a read-only "
+                "mtime register at offset 0xBFF8 that returns the value of the "
+                "time CSR. The CLINT drives the Machine software and timer "
+                "interrupts of each hart directly."
+            );
+        }
+
         // document whether cycle CSR is implemented
         if(cfg->cycle_undefined) {
             vmidocAddText(
@@ -30,13 +30,17 @@
 
 // model header files
 #include "riscvCLIC.h"
+#include "riscvCLINT.h"
+#include "riscvCommitRing.h"
 #include "riscvCSR.h"
 #include "riscvDecode.h"
 #include "riscvExceptions.h"
 #include "riscvExceptionDefinitions.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
+#include "riscvSemiHost.h"
 #include "riscvStructure.h"
+#include "riscvTrapProfile.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
 #include "riscvVMConstants.h"
@@ -258,6 +262,65 @@ static void restartProcessor(riscvP riscv, riscvDisableReason reason) {
     }
 }
 
+//
+// Return mask of interrupts taken in the given mode, which are masked by the
+// global interrupt enable bit of that mode
+//
+static Uns64 getModeInterrupts(riscvP riscv, riscvMode modeIE) {
+
+    Uns64 mideleg = RD_CSR(riscv, mideleg);
+    Uns64 sideleg = RD_CSR(riscv, sideleg) & mideleg;
+    Uns64 hideleg = RD_CSR(riscv, hideleg) & mideleg;
+
+    switch(modeIE) {
+        case RISCV_MODE_M:  return ~mideleg;
+        case RISCV_MODE_S:  return mideleg & ~(hideleg|sideleg);
+        case RISCV_MODE_U:  return sideleg;
+        case RISCV_MODE_VS: return hideleg;
+        default:            return 0;
+    }
+}
+
+//
+// Record that the pending-and-enabled state of the interrupts in the mask may
+// have changed, so that only these are recomputed at the next refresh
+//
+void riscvMarkInterruptStale(riscvP riscv, Uns64 mask) {
+    riscv->intSelect.stale |= mask;
+}
+
+//
+// Record a change to the global interrupt enable bit of the given mode
+//
+inline static void changeIE(riscvP riscv, riscvMode modeIE) {
+    riscvMarkInterruptStale(riscv, getModeInterrupts(riscv, modeIE));
+}
+
+//
+// Record a change to the global interrupt enable bits in mstatus (or vsstatus
+// if V is True), where changed is the mask of modified bits
+//
+void riscvUpdateInterruptEnable(riscvP riscv, Uns32 changed, Bool V) {
+
+    if(changed & WM_mstatus_MIE) {
+        changeIE(riscv, RISCV_MODE_M);
+    }
+    if(changed & WM_mstatus_SIE) {
+        changeIE(riscv, V ? RISCV_MODE_VS : RISCV_MODE_S);
+    }
+    if(changed & WM_mstatus_UIE) {
+        changeIE(riscv, V ? RISCV_MODE_VU : RISCV_MODE_U);
+    }
+}
+
+//
+// Record a change to state that may affect any interrupt
+//
+inline static void changeAllInts(riscvP riscv) {
+    riscvMarkInterruptStale(riscv, -1);
+    riscv->intSelect.dirty = True;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // TAKING EXCEPTIONS
@@ -406,6 +469,7 @@ static void trapU(riscvP riscv, trapCxtP cxt) {
     // update interrupt enable and interrupt enable stack
     WR_CSR_FIELD(riscv, mstatus, UPIE, IE);
     WR_CSR_FIELD(riscv, mstatus, UIE, 0);
+    changeIE(riscv, RISCV_MODE_U);
 
     // clear cause register if not in CLIC mode
     if(!useCLICM(riscv)) {
@@ -445,6 +509,7 @@ static void trapVU(riscvP riscv, trapCxtP cxt) {
     // update interrupt enable and interrupt enable stack
     WR_CSR_FIELD(riscv, vsstatus, UPIE, IE);
     WR_CSR_FIELD(riscv, vsstatus, UIE, 0);
+    changeIE(riscv, RISCV_MODE_VU);
 
     // clear ucause register if not in CLIC mode
     if(!useCLICM(riscv)) {
@@ -482,6 +547,7 @@ static void trapHS(riscvP riscv, trapCxtP cxt) {
     // update interrupt enable and interrupt enable stack
     WR_CSR_FIELD(riscv, mstatus, SPIE, IE);
     WR_CSR_FIELD(riscv, mstatus, SIE, 0);
+    changeIE(riscv, RISCV_MODE_S);
 
     // clear scause register if not in CLIC mode
     if(!useCLICM(riscv)) {
@@ -532,6 +598,7 @@ static void trapVS(riscvP riscv, trapCxtP cxt) {
     // update interrupt enable and interrupt enable stack
     WR_CSR_FIELD(riscv, vsstatus, SPIE, IE);
     WR_CSR_FIELD(riscv, vsstatus, SIE, 0);
+    changeIE(riscv, RISCV_MODE_VS);
 
     // clear vscause register if not in CLIC mode
     if(!useCLICM(riscv)) {
@@ -572,6 +639,7 @@ static void trapM(riscvP riscv, trapCxtP cxt) {
     // update interrupt enable and interrupt enable stack
     WR_CSR_FIELD(riscv, mstatus, MPIE, IE);
     WR_CSR_FIELD(riscv, mstatus, MIE, 0);
+    changeIE(riscv, RISCV_MODE_M);
 
     // clear mcause register if not in CLIC mode
     if(!useCLICM(riscv)) {
@@ -769,6 +837,11 @@ void riscvTakeException(
     riscvException exception,
     Uns64          tval
 ) {
+    // the instruction at the exception address has not retired
+    if(riscv->commitRing) {
+        riscvCommitRingTrap(riscv, getEPC(riscv));
+    }
+
     if(inDebugMode(riscv)) {
 
         // terminate execution of program buffer
@@ -904,6 +977,9 @@ void riscvTakeException(
         // set address at which to execute
         setPCException(riscv, cxt.handlerPC);
 
+        // record trap entry if profiling
+        riscvProfileTrapEntry(riscv, exception, cxt.modeX);
+
         // notify derived model of exception entry if required
         for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
             notifyTrapDerived(
@@ -933,6 +1009,9 @@ void riscvTakeAsynchonousException(
         restartProcessor(riscv, RVD_RESTART_WFI);
     }
 
+    // the previous instruction has retired
+    riscvCommitRingFlush(riscv);
+
     // take exception
     riscvTakeException(riscv, exception, tval);
 
@@ -1019,6 +1098,13 @@ void riscvTakeMemoryException(
     riscvException exception,
     Uns64          tval
 ) {
+    // when probing mappings, record failure but take no exception (the access
+    // will be repeated later)
+    if(riscv->VMProbe) {
+        riscv->VMProbeFail = True;
+        return;
+    }
+
     // force vstart to zero if required
     MASK_CSR(riscv, vstart);
 
@@ -1125,6 +1211,9 @@ static void doERETCommon(riscvP riscv, riscvMode newMode, Uns64 epc) {
     // jump to return address
     setPCxRET(riscv, epc);
 
+    // record trap return if profiling
+    riscvProfileTrapReturn(riscv);
+
     // notify derived model of exception return if required
     notifyERETDerived(riscv, oldMode);
 
@@ -1166,6 +1255,7 @@ void riscvMRET(riscvP riscv) {
 
     // restore previous MIE
     WR_CSR_FIELD(riscv, mstatus, MIE, RD_CSR_FIELD(riscv, mstatus, MPIE))
+    changeIE(riscv, RISCV_MODE_M);
 
     // MPIE=1
     WR_CSR_FIELD(riscv, mstatus, MPIE, 1);
@@ -1210,6 +1300,7 @@ void riscvHSRET(riscvP riscv) {
 
     // restore previous SIE
     WR_CSR_FIELD(riscv, mstatus, SIE, RD_CSR_FIELD(riscv, mstatus, SPIE))
+    changeIE(riscv, RISCV_MODE_S);
 
     // SPIE=1
     WR_CSR_FIELD(riscv, mstatus, SPIE, 1);
@@ -1247,6 +1338,7 @@ void riscvVSRET(riscvP riscv) {
 
     // restore previous SIE
     WR_CSR_FIELD(riscv, vsstatus, SIE, RD_CSR_FIELD(riscv, vsstatus, SPIE))
+    changeIE(riscv, RISCV_MODE_VS);
 
     // SPIE=1
     WR_CSR_FIELD(riscv, vsstatus, SPIE, 1);
@@ -1281,6 +1373,7 @@ void riscvURET(riscvP riscv) {
 
     // restore previous UIE
     WR_CSR_FIELD(riscv, mstatus, UIE, RD_CSR_FIELD(riscv, mstatus, UPIE))
+    changeIE(riscv, RISCV_MODE_U);
 
     // UPIE=1
     WR_CSR_FIELD(riscv, mstatus, UPIE, 1);
@@ -1304,6 +1397,7 @@ void riscvVURET(riscvP riscv) {
 
     // restore previous UIE
     WR_CSR_FIELD(riscv, vsstatus, UIE, RD_CSR_FIELD(riscv, vsstatus, UPIE))
+    changeIE(riscv, RISCV_MODE_VU);
 
     // UPIE=1
     WR_CSR_FIELD(riscv, vsstatus, UPIE, 1);
@@ -1539,6 +1633,10 @@ void riscvEBREAK(riscvP riscv) {
         // handle EBREAK as Debug module action
         enterDM(riscv, DMC_EBREAK);
 
+    } else if(riscvSemihostEBREAK(riscv)) {
+
+        // EBREAK in semihosting sequence handled as semihosting operation
+
     } else {
 
         // from privileged version 1.12, EBREAK no longer sets mtval to the PC
@@ -1876,9 +1974,27 @@ static Uns32 getIntPri(riscvP riscv, Uns32 intNum) {
 }
 
 //
-// Refresh pending basic interrupt state
+// Return True if any extension supplies custom interrupt priorities, which may
+// change at any time so that a previous selection cannot be reused
 //
-static void refreshPendingAndEnabledBasic(riscvP riscv) {
+static Bool customIntPri(riscvP riscv) {
+
+    riscvExtCBP extCB;
+
+    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+        if(extCB->getInterruptPri) {
+            return True;
+        }
+    }
+
+    return False;
+}
+
+//
+// Return mask of pending basic mode interrupts that are enabled by the global
+// interrupt enable bits, given the current mode and delegation
+//
+static Uns64 getPendingAndEnabledBasic(riscvP riscv) {
 
     Uns64 pendingEnabled = getPendingBasic(riscv);
 
@@ -1917,6 +2033,38 @@ static void refreshPendingAndEnabledBasic(riscvP riscv) {
         if(!VUIE) {pendingEnabled &= ~vuMask;}
     }
 
+    return pendingEnabled;
+}
+
+//
+// Refresh pending basic interrupt state
+//
+static void refreshPendingAndEnabledBasic(riscvP riscv) {
+
+    riscvIntSelectP cache = &riscv->intSelect;
+    Uns64           stale = cache->stale;
+    riscvMode       mode  = getCurrentMode5(riscv);
+    Uns64           pendingEnabled;
+
+    // recompute the state of interrupts affected by changes since the last
+    // refresh, invalidating the selection if the result differs
+    if(stale) {
+
+        pendingEnabled = (
+            (cache->pendingEnabled & ~stale) |
+            (getPendingAndEnabledBasic(riscv) & stale)
+        );
+
+        if(cache->pendingEnabled!=pendingEnabled) {
+            cache->pendingEnabled = pendingEnabled;
+            cache->dirty          = True;
+        }
+
+        cache->stale = 0;
+    }
+
+    pendingEnabled = cache->pendingEnabled;
+
     // print exception status
     if(RISCV_DEBUG_EXCEPT(riscv)) {
 
@@ -1959,12 +2107,29 @@ static void refreshPendingAndEnabledBasic(riscvP riscv) {
     }
 
     // select highest-priority pending-and-enabled interrupt
-    if(pendingEnabled) {
+    if(!pendingEnabled) {
+
+        // no interrupt selected
+
+    } else if(
+        !cache->dirty &&
+        (cache->mode==mode) &&
+        !customIntPri(riscv)
+    ) {
+
+        // contributing state is unchanged, so reuse the previous selection
+        riscv->pendEnab = cache->selected;
+
+    } else {
 
         riscvPendEnabP selected = &riscv->pendEnab;
         Int32          id       = 0;
         Uns8           selPri   = 0;
 
+        // record key for the new selection
+        cache->mode  = mode;
+        cache->dirty = False;
+
         do {
 
             if(pendingEnabled&1) {
@@ -1995,6 +2160,9 @@ static void refreshPendingAndEnabledBasic(riscvP riscv) {
             id++;
 
         } while(pendingEnabled);
+
+        // save selection for reuse
+        cache->selected = *selected;
     }
 }
 
@@ -2473,13 +2641,121 @@ inline static Bool negedge(Uns32 old, Uns32 new) {
     return old && !new;
 }
 
+//
+// State used to find the next wake-up time of an idle cluster
+//
+typedef struct wfiWarpS {
+    Bool  idle;         // whether all harts are idle
+    Uns64 wakeTime;     // earliest known wake-up time
+} wfiWarp, *wfiWarpP;
+
+//
+// Return the earliest wake-up time known for the hart
+//
+static Uns64 getNextWakeTime(riscvP riscv) {
+
+    Uns64       result = riscvGetCLINTWakeTime(riscv);
+    riscvExtCBP extCB;
+
+    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+
+        if(extCB->nextWake) {
+
+            Uns64 wakeTime = extCB->nextWake(riscv, extCB->clientData);
+
+            if(result>wakeTime) {
+                result = wakeTime;
+            }
+        }
+    }
+
+    return result;
+}
+
+//
+// Determine whether a hart is idle and update the earliest wake-up time
+//
+static VMI_SMP_ITER_FN(findWakeTimeCB) {
+
+    if(vmirtGetSMPCpuType(processor)==SMP_TYPE_LEAF) {
+
+        riscvP   hart = (riscvP)processor;
+        wfiWarpP warp = userData;
+
+        if(!hart->disable || (hart->disable & RVD_DEBUG)) {
+
+            // hart is running or halted for debug
+            warp->idle = False;
+
+        } else if(hart->disable & RVD_WFI) {
+
+            Uns64 wakeTime = getNextWakeTime(hart);
+
+            if(warp->wakeTime>wakeTime) {
+                warp->wakeTime = wakeTime;
+            }
+        }
+    }
+}
+
+//
+// Advance time for a hart and notify clients so that any interrupt now due
+// is signalled
+//
+static VMI_SMP_ITER_FN(doTimeWarpCB) {
+
+    if(vmirtGetSMPCpuType(processor)==SMP_TYPE_LEAF) {
+
+        riscvP      hart  = (riscvP)processor;
+        Uns64       delta = *(Uns64 *)userData;
+        riscvExtCBP extCB;
+
+        riscvWarpTime(hart, delta);
+
+        // refresh internal CLINT timer interrupt
+        riscvUpdateCLINT(hart);
+
+        for(extCB=hart->extCBs; extCB; extCB=extCB->next) {
+            if(extCB->timeWarpNotifier) {
+                extCB->timeWarpNotifier(hart, extCB->clientData);
+            }
+        }
+    }
+}
+
+//
+// When all harts in the cluster are idle, advance time directly to the
+// earliest known wake-up time instead of waiting for it to elapse
+//
+static void doWFITimeWarp(riscvP riscv) {
+
+    vmiProcessorP root = (vmiProcessorP)riscv->smpRoot;
+    wfiWarp       warp = {idle:True, wakeTime:RISCV_NO_WAKE_TIME};
+
+    vmirtIterAllProcessors(root, findWakeTimeCB, &warp);
+
+    if(warp.idle && (warp.wakeTime!=RISCV_NO_WAKE_TIME)) {
+
+        Uns64 now   = riscvGetTime(riscv);
+        Uns64 delta = (warp.wakeTime>now) ? warp.wakeTime-now : 0;
+
+        vmirtIterAllProcessors(root, doTimeWarpCB, &delta);
+    }
+}
+
 //
 // Halt the processor in WFI state if required
 //
 void riscvWFI(riscvP riscv) {
 
     if(!(inDebugMode(riscv) || getPending(riscv))) {
+
         haltProcessor(riscv, RVD_WFI);
+
+        // skip idle time if required
+        if(riscv->configInfo.wfi_time_warp) {
+            doWFITimeWarp(riscv);
+        }
     }
 }
 
@@ -2512,6 +2788,23 @@ void riscvTestInterrupt(riscvP riscv) {
     handlePendingAndEnabled(riscv);
 }
 
+//
+// Check for pending interrupts after a change to interrupt delegation, where
+// changed is the mask of interrupts with modified delegation
+//
+void riscvUpdateInterruptDelegation(riscvP riscv, Uns64 changed) {
+
+    // recompute the state of modified interrupts, and the cached selection
+    // only if it depends on a modified interrupt
+    riscvMarkInterruptStale(riscv, changed);
+
+    if(riscv->intSelect.pendingEnabled & changed) {
+        riscv->intSelect.dirty = True;
+    }
+
+    riscvTestInterrupt(riscv);
+}
+
 //
 // Reset the processor
 //
@@ -2531,9 +2824,18 @@ void riscvReset(riscvP riscv) {
     // reset CSR state
     riscvCSRReset(riscv);
 
+    // discard cached interrupt state (any contributing state may have changed)
+    changeAllInts(riscv);
+
     // reset CLIC state
     riscvResetCLIC(riscv);
 
+    // reset CLINT state
+    riscvResetCLINT(riscv);
+
+    // reset trap profile nesting state
+    riscvResetTrapProfile(riscv);
+
     // notify dependent model of reset event
     for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
         if(extCB->resetNotifier) {
@@ -2697,11 +2999,38 @@ void riscvUpdatePending(riscvP riscv) {
 
     // update register value and exception state on a change
     if(oldValue != newValue) {
+
+        // record each pending change once if profiling
+        if(riscv->trapProfile) {
+
+            Uns64 changed = oldValue ^ newValue;
+            Uns32 i;
+
+            for(i=0; changed; i++, changed>>=1) {
+                if(changed&1) {
+                    riscvProfileInterruptInput(riscv, i, (newValue>>i)&1);
+                }
+            }
+        }
+
         WR_CSR(riscv, mip, newValue);
+        riscvMarkInterruptStale(riscv, oldValue^newValue);
         riscvTestInterrupt(riscv);
     }
 }
 
+//
+// Update interrupt state after a change by a derived model that may affect
+// any interrupt
+//
+void riscvUpdateInterruptState(riscvP riscv) {
+
+    // discard cached interrupt state
+    changeAllInts(riscv);
+
+    riscvUpdatePending(riscv);
+}
+
 //
 // Reset signal
 //
@@ -2785,16 +3114,13 @@ static VMI_NET_CHANGE_FN(SCValidPortCB) {
 }
 
 //
-// Generic interrupt signal
+// Update state when the indexed interrupt input changes value
 //
-static VMI_NET_CHANGE_FN(interruptPortCB) {
+void riscvUpdateInterruptInput(riscvP riscv, Uns32 index, Bool newValue) {
 
-    riscvInterruptInfoP ii     = userData;
-    riscvP              riscv  = ii->hart;
-    Uns32               index  = ii->userData;
-    Uns32               offset = index/64;
-    Uns64               mask   = 1ULL << (index&63);
-    Uns32               maxNum = riscvGetIntNum(riscv);
+    Uns32 offset = index/64;
+    Uns64 mask   = 1ULL << (index&63);
+    Uns32 maxNum = riscvGetIntNum(riscv);
 
     // sanity check
     VMI_ASSERT(
@@ -2810,6 +3136,12 @@ static VMI_NET_CHANGE_FN(interruptPortCB) {
         riscv->ip[offset] &= ~mask;
     }
 
+    // record input change if profiling (with a basic interrupt controller,
+    // riscvUpdatePending records the resulting change of mip instead)
+    if(!basicICPresent(riscv)) {
+        riscvProfileInterruptInput(riscv, index, newValue);
+    }
+
     // update CLIC interrupt controller if required
     if(CLICInternal(riscv)) {
         riscvUpdateCLICInput(riscv, index, newValue);
@@ -2821,6 +3153,16 @@ static VMI_NET_CHANGE_FN(interruptPortCB) {
     }
 }
 
+//
+// Generic interrupt signal
+//
+static VMI_NET_CHANGE_FN(interruptPortCB) {
+
+    riscvInterruptInfoP ii = userData;
+
+    riscvUpdateInterruptInput(ii->hart, ii->userData, newValue);
+}
+
 //
 // Guest external interrupt signal
 //
@@ -3433,6 +3775,11 @@ void riscvNetSave(
             riscvSaveCLIC(riscv, cxt, phase);
         }
 
+        // save internal CLINT state
+        if(CLINTInternal(riscv)) {
+            riscvSaveCLINT(riscv, cxt, phase);
+        }
+
         // save guest external interrupt state
         if(getGEILEN(riscv)) {
             VMIRT_SAVE_FIELD(cxt, riscv, csr.hgeip);
@@ -3466,12 +3813,18 @@ void riscvNetRestore(
             riscvRestoreCLIC(riscv, cxt, phase);
         }
 
+        // restore internal CLINT state
+        if(CLINTInternal(riscv)) {
+            riscvRestoreCLINT(riscv, cxt, phase);
+        }
+
         // restore guest external interrupt state
         if(getGEILEN(riscv)) {
             VMIRT_RESTORE_FIELD(cxt, riscv, csr.hgeip);
         }
 
-        // refresh core state
+        // discard cached interrupt state and refresh core state
+        changeAllInts(riscv);
         riscvUpdatePending(riscv);
     }
 }
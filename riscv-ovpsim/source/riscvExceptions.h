@@ -161,6 +161,11 @@ void riscvExceptFree(riscvP riscv);
 //
 void riscvUpdatePending(riscvP riscv);
 
+//
+// Update state when the indexed interrupt input changes value
+//
+void riscvUpdateInterruptInput(riscvP riscv, Uns32 index, Bool newValue);
+
 //
 // Refresh pending-and-enabled interrupt state
 //
@@ -171,6 +176,30 @@ void riscvRefreshPendingAndEnabled(riscvP riscv);
 //
 void riscvTestInterrupt(riscvP riscv);
 
+//
+// Check for pending interrupts after a change to interrupt delegation, where
+// changed is the mask of interrupts with modified delegation
+//
+void riscvUpdateInterruptDelegation(riscvP riscv, Uns64 changed);
+
+//
+// Record that the pending-and-enabled state of the interrupts in the mask may
+// have changed, so that only these are recomputed at the next refresh
+//
+void riscvMarkInterruptStale(riscvP riscv, Uns64 mask);
+
+//
+// Record a change to the global interrupt enable bits in mstatus (or vsstatus
+// if V is True), where changed is the mask of modified bits
+//
+void riscvUpdateInterruptEnable(riscvP riscv, Uns32 changed, Bool V);
+
+//
+// Update interrupt state after a change by a derived model that may affect
+// any interrupt
+//
+void riscvUpdateInterruptState(riscvP riscv);
+
 //
 // Allocate ports for this variant
 //
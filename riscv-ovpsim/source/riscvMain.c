@@ -27,10 +27,14 @@
 #include "vmi/vmiRt.h"
 
 // Model header files
+#include "riscvBatch.h"
 #include "riscvCLIC.h"
+#include "riscvCLINT.h"
 #include "riscvCluster.h"
 #include "riscvBus.h"
+#include "riscvCheckpoint.h"
 #include "riscvConfig.h"
+#include "riscvCommitRing.h"
 #include "riscvCSR.h"
 #include "riscvDebug.h"
 #include "riscvDecode.h"
@@ -41,7 +45,11 @@
 #include "riscvMessage.h"
 #include "riscvMorph.h"
 #include "riscvParameters.h"
+#include "riscvRunProfile.h"
+#include "riscvSemiHost.h"
+#include "riscvSignature.h"
 #include "riscvStructure.h"
+#include "riscvTrapProfile.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
 #include "riscvVMConstants.h"
@@ -78,7 +86,7 @@ static void initLeafModelCBs(riscvP riscv) {
     riscv->cb.writeBaseCSR       = riscvWriteBaseCSR;
 
     // from riscvExceptions.h
-    riscv->cb.testInterrupt      = riscvUpdatePending;
+    riscv->cb.testInterrupt      = riscvUpdateInterruptState;
     riscv->cb.illegalInstruction = riscvIllegalInstruction;
     riscv->cb.takeException      = riscvTakeAsynchonousException;
 
@@ -244,6 +252,7 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
     cfg->bitmanip_version    = params->bitmanip_version;
     cfg->fp16_version        = params->fp16_version;
     cfg->mstatus_fs_mode     = params->mstatus_fs_mode;
+    cfg->TLB_save            = params->TLB_save;
     cfg->reset_address       = params->reset_address;
     cfg->nmi_address         = params->nmi_address;
     cfg->ASID_bits           = params->ASID_bits;
@@ -269,6 +278,16 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
     cfg->unaligned           = params->unaligned;
     cfg->unalignedAMO        = params->unalignedAMO;
     cfg->wfi_is_nop          = params->wfi_is_nop;
+    cfg->wfi_time_warp       = params->wfi_time_warp;
+    cfg->CLINT_address       = params->CLINT_address;
+    cfg->trap_profile        = params->trap_profile;
+    cfg->semihost_ebreak     = params->semihost_ebreak;
+    cfg->semihost_memops     = params->semihost_memops;
+    cfg->signature_granularity = params->signature_granularity;
+    cfg->delta_checkpoint    = params->delta_checkpoint;
+    cfg->fork_count          = params->fork_count;
+    cfg->fork_jobs           = params->fork_jobs;
+    cfg->fork_index_address  = params->fork_index_address;
     cfg->mtvec_is_ro         = params->mtvec_is_ro;
     cfg->counteren_mask      = params->counteren_mask;
     cfg->noinhibit_mask      = params->noinhibit_mask;
@@ -374,6 +393,15 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
         cfg->SEW_min = cfg->ELEN;
     }
 
+    // time warp offsets only the view of time seen by the harts, so it is
+    // valid only if the timer is also modeled by the internal CLINT
+    if(cfg->wfi_time_warp && !cfg->CLINT_address) {
+        vmiMessage("W", CPU_PREFIX"_IWTW",
+            "'wfi_time_warp' requires 'CLINT_address' - ignored"
+        );
+        cfg->wfi_time_warp = False;
+    }
+
     if(misa_MXL==1) {
 
         // modify configuration for 32-bit cores - misa_MXL is not writable
@@ -525,6 +553,40 @@ VMI_CONSTRUCTOR_FN(riscvConstructor) {
             riscvNewCLIC(riscv, smpContext->index);
         }
 
+        // allocate CLINT data structures if required
+        if(CLINTInternal(riscv)) {
+            riscvNewCLINT(riscv, smpContext->index);
+        }
+
+        // allocate trap profile data structures if required
+        riscvNewTrapProfile(riscv);
+
+        // add register snapshot commands
+        riscvAddSnapCommands(riscv);
+
+        // allocate fan-out timer if required
+        riscvNewFanOut(riscv, paramValues->fork_log);
+
+        // start run profile and commit ring on the first hart if required
+        if(!smpContext->index) {
+            riscvNewRunProfile(riscv, paramValues->run_profile);
+            riscvNewCommitRing(riscv, paramValues->commit_ring);
+        }
+
+        // start batch mode or signature dump on the first hart if required
+        if(smpContext->index) {
+            // not the first hart
+        } else if(paramValues->batch_list[0] || paramValues->batch_socket[0]) {
+            riscvNewBatch(
+                riscv,
+                paramValues->batch_list,
+                paramValues->batch_socket,
+                paramValues->batch_instruction_limit
+            );
+        } else {
+            riscvNewSignature(riscv, paramValues->signature_file);
+        }
+
         // do initial reset
         riscvReset(riscv);
     }
@@ -581,6 +643,33 @@ VMI_DESTRUCTOR_FN(riscvDestructor) {
     // free CLIC data structures
     riscvFreeCLIC(riscv);
 
+    // free CLINT data structures
+    riscvFreeCLINT(riscv);
+
+    // report and free trap profile
+    riscvFreeTrapProfile(riscv);
+
+    // flush and free buffered semihosting state
+    riscvFreeSemihost(riscv);
+
+    // free delta checkpoint data structures
+    riscvFreeDeltaCheckpoint(riscv);
+
+    // free fan-out timer and child output file name
+    riscvFreeFanOut(riscv);
+
+    // free batch mode data structures
+    riscvFreeBatch(riscv);
+
+    // write any outstanding signature
+    riscvFreeSignature(riscv);
+
+    // write run profile
+    riscvFreeRunProfile(riscv);
+
+    // publish outstanding commit ring records
+    riscvFreeCommitRing(riscv);
+
     // free PMP structures
     riscvVMFreePMP(riscv);
 }
@@ -700,6 +789,9 @@ VMI_SAVE_STATE_FN(riscvSaveState) {
     // save timer state not covered by register read/write API
     riscvTimerSave(riscv, cxt, phase);
 
+    // save memory pages dirtied since the previous checkpoint
+    riscvDeltaCheckpointSave(riscv, cxt, phase);
+
     // end of SMP cluster
     if(phase==SRT_END) {
         vmirtIterAllProcessors(processor, endSave, 0);
@@ -755,6 +847,12 @@ VMI_RESTORE_STATE_FN(riscvRestoreState) {
     // restore timer state not covered by register read/write API
     riscvTimerRestore(riscv, cxt, phase);
 
+    // restore memory pages saved in a delta checkpoint
+    riscvDeltaCheckpointRestore(riscv, cxt, phase);
+
+    // schedule fan-out from the restored state if required
+    riscvFanOutRestore(riscv, phase);
+
     // end of SMP cluster
     if(phase==SRT_END) {
         vmirtIterAllProcessors(processor, endRestore, 0);
@@ -394,6 +394,32 @@ typedef RISCV_GET_INTERRUPT_PRI_FN((*riscvGetInterruptPriFn));
 )
 typedef RISCV_HR_NOTIFIER_FN((*riscvHRNotifierFn));
 
+//
+// Value returned by riscvNextWakeFn if no wake-up event is scheduled
+//
+#define RISCV_NO_WAKE_TIME ((Uns64)-1)
+
+//
+// Return the time (in units of the time CSR) at which an interrupt will next
+// become pending for this hart because of state owned by the client (for
+// example, a timer compare register), or RISCV_NO_WAKE_TIME if none
+//
+#define RISCV_NEXT_WAKE_FN(_NAME) Uns64 _NAME( \
+    riscvP riscv,               \
+    void  *clientData           \
+)
+typedef RISCV_NEXT_WAKE_FN((*riscvNextWakeFn));
+
+//
+// Notifier called when time has been advanced by WFI time warp, allowing the
+// client to signal any interrupt that is now due
+//
+#define RISCV_TIME_WARP_NOTIFIER_FN(_NAME) void _NAME( \
+    riscvP riscv,               \
+    void  *clientData           \
+)
+typedef RISCV_TIME_WARP_NOTIFIER_FN((*riscvTimeWarpNotifierFn));
+
 //
 // Notifier called on a model context switch. 'state' describes the new state.
 //
@@ -531,6 +557,8 @@ typedef struct riscvExtCBS {
 
     // halt/restart actions
     riscvHRNotifierFn         haltRestartNotifier;
+    riscvNextWakeFn           nextWake;
+    riscvTimeWarpNotifierFn   timeWarpNotifier;
 
     // code generation actions
     riscvDerivedMorphFn       preMorph;
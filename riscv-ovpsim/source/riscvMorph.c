@@ -17,6 +17,9 @@
  *
  */
 
+// standard header files
+#include <string.h>
+
 // Imperas header files
 #include "hostapi/impAlloc.h"
 
@@ -28,6 +31,7 @@
 // model header files
 #include "riscvBExtension.h"
 #include "riscvBlockState.h"
+#include "riscvCommitRing.h"
 #include "riscvCSRTypes.h"
 #include "riscvDecode.h"
 #include "riscvDecodeTypes.h"
@@ -37,10 +41,12 @@
 #include "riscvModelCallbackTypes.h"
 #include "riscvMorph.h"
 #include "riscvRegisters.h"
+#include "riscvRunProfile.h"
 #include "riscvStructure.h"
 #include "riscvTypeRefs.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
+#include "riscvVMConstants.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4468,6 +4474,70 @@ static RISCV_MORPH_FN(emitSHADD) {
 // VECTOR UNIT CONFIGURATION
 ////////////////////////////////////////////////////////////////////////////////
 
+//
+// Compute maximum vector length for the given vector type settings
+//
+static Uns32 computeMaxVL(riscvP riscv, riscvVType vtype) {
+
+    Uns32          VLEN    = riscv->configInfo.VLEN;
+    riscvSEWMt     SEW     = getVTypeSEW(vtype);
+    riscvVLMULx8Mt VLMULx8 = vtypeToVLMULx8(vtype);
+
+    return (VLMULx8*VLEN)/(SEW*8);
+}
+
+//
+// If the specified vtype is valid, compute the SEW, otherwise return
+// SEWMT_UNKNOWN
+//
+static riscvSEWMt computeValidSEW(riscvP riscv, riscvVType vtype) {
+
+    riscvSEWMt     SEW_min = riscv->configInfo.SEW_min;
+    riscvSEWMt     ELEN    = riscv->configInfo.ELEN;
+    riscvSEWMt     VLEN    = riscv->configInfo.VLEN;
+    riscvSEWMt     FRLEN   = (ELEN<VLEN) ? ELEN : VLEN ;
+    riscvSEWMt     SEW     = getVTypeSEW(vtype);
+    riscvVLMULx8Mt VLMULx8 = vtypeToVLMULx8(vtype);
+
+    if(
+        // validate fields that must be zero
+        getVTypeZero(vtype) ||
+        // validate vlmulf setting
+        ((getVTypeSVLMUL(vtype)<0) && !vectorFractLMUL(riscv)) ||
+        // validate agnostic settings
+        ((getVTypeVTA(vtype)||getVTypeVMA(vtype)) && !vectorAgnostic(riscv)) ||
+        // validate SEW is supported
+        (SEW<SEW_min) || (SEW>ELEN) ||
+        // validate LMUL>=(SEW/FRLEN)
+        !(VLMULx8>=((SEW*8)/FRLEN))
+    ) {
+        SEW = SEWMT_UNKNOWN;
+    }
+
+    return SEW;
+}
+
+//
+// Precompute legality, SEW, VLMAX and polymorphic key component for every
+// vtype encoding, so that vsetvl/vsetvli need not derive them each time
+//
+static void initVTypeInfo(riscvP riscv) {
+
+    Uns32 i;
+
+    riscv->vtypeInfo = STYPE_CALLOC_N(riscvVTypeInfo, VTYPE_INFO_NUM);
+
+    for(i=0; i<VTYPE_INFO_NUM; i++) {
+
+        riscvVType      vtype = composeVType(riscv, i);
+        riscvVTypeInfoP info  = &riscv->vtypeInfo[i];
+
+        info->SEW   = computeValidSEW(riscv, vtype);
+        info->VLMAX = computeMaxVL(riscv, vtype);
+        info->pmKey = i<<2;
+    }
+}
+
 //
 // Configure vector extension
 //
@@ -4475,9 +4545,12 @@ void riscvConfigureVector(riscvP riscv) {
 
     Uns32 vRegBytes = riscv->configInfo.VLEN/8;
 
-    // allocate vector registers if required
+    // allocate vector registers, vtype lookup table and indexed access page
+    // list if required (each of at most VLEN elements spans at most two pages)
     if(riscv->configInfo.arch & ISA_V) {
-        riscv->v = STYPE_CALLOC_N(Uns32, (vRegBytes/4)*VREG_NUM);
+        riscv->v      = STYPE_CALLOC_N(Uns32, (vRegBytes/4)*VREG_NUM);
+        riscv->vPages = STYPE_CALLOC_N(Uns64, riscv->configInfo.VLEN*2);
+        initVTypeInfo(riscv);
     }
 }
 
@@ -4490,6 +4563,16 @@ void riscvFreeVector(riscvP riscv) {
     if(riscv->v) {
     	STYPE_FREE(riscv->v);
     }
+
+    // free vtype lookup table if required
+    if(riscv->vtypeInfo) {
+        STYPE_FREE(riscv->vtypeInfo);
+    }
+
+    // free indexed access page list if required
+    if(riscv->vPages) {
+        STYPE_FREE(riscv->vPages);
+    }
 }
 
 
@@ -4549,6 +4632,7 @@ typedef struct iterDescS {
     Uns32          vBytesMax;           // vector size (including padding)
     vmiLabelP      maskF;               // target if mask=0
     vmiLabelP      skip;                // target if body is skipped
+    vmiLabelP      whole;               // target if block transfer done
 } iterDesc;
 
 //
@@ -6689,6 +6773,31 @@ static riscvVLClassMt fillVectorOperationData(
     return vlClass;
 }
 
+//
+// Emit code for a whole-register move, copying the register group bytes
+// directly (NOTE: vstart is reset to zero for whole-register moves, and the
+// source and destination are either identical or do not overlap)
+//
+static void emitVMVRWhole(
+    riscvMorphStateP state,
+    iterDescP        id,
+    riscvVLClassMt   vlClass
+) {
+    Uns32 dIndex = getRIndex(getRVReg(state, 0));
+    Uns32 sIndex = getRIndex(getRVReg(state, 1));
+
+    // start a new vector operation
+    startVectorOp(state, id, True);
+
+    // copy register group if source and destination differ
+    if(dIndex!=sIndex) {
+        vmimtMoveRR(id->VLEN, id->r[0], id->r[1]);
+    }
+
+    // perform actions at end of instruction
+    endVectorOp(state, id, vlClass);
+}
+
 //
 // Emit code to dispatch a vector operation
 //
@@ -6715,6 +6824,11 @@ static RISCV_MORPH_FN(emitVectorOp) {
 
             // failed operation-specific check
 
+        } else if(state->info.isWhole==RV_WD_MV) {
+
+            // whole-register move
+            emitVMVRWhole(state, &id, vlClass);
+
         } else if(vlClass!=VLCLASSMT_ZERO) {
 
             vmiLabelP   loop   = vmimtNewLabel();
@@ -6748,6 +6862,11 @@ static RISCV_MORPH_FN(emitVectorOp) {
             // repeat until done
             endVectorLoop(state, &id, loop);
 
+            // here if whole-register load/store was done as a block transfer
+            if(id.whole) {
+                vmimtInsertLabel(id.whole);
+            }
+
             // perform actions at end of instruction
             endVectorOp(state, &id, vlClass);
         }
@@ -6872,16 +6991,18 @@ void riscvWVStart(riscvMorphStateP state, Bool useRS1) {
     updateVS(riscv);
 }
 
+//
+// Return precomputed information for the given vtype
+//
+inline static riscvVTypeInfoP getVTypeInfo(riscvP riscv, riscvVType vtype) {
+    return &riscv->vtypeInfo[vtype.u.u32 & (VTYPE_INFO_NUM-1)];
+}
+
 //
 // Return maximum vector length for the given vector type settings
 //
 Uns32 riscvGetMaxVL(riscvP riscv, riscvVType vtype) {
-
-    Uns32          VLEN    = riscv->configInfo.VLEN;
-    riscvSEWMt     SEW     = getVTypeSEW(vtype);
-    riscvVLMULx8Mt VLMULx8 = vtypeToVLMULx8(vtype);
-
-    return (VLMULx8*VLEN)/(SEW*8);
+    return getVTypeInfo(riscv, vtype)->VLMAX;
 }
 
 //
@@ -6890,29 +7011,11 @@ Uns32 riscvGetMaxVL(riscvP riscv, riscvVType vtype) {
 //
 riscvSEWMt riscvValidVType(riscvP riscv, riscvVType vtype) {
 
-    riscvSEWMt     SEW_min = riscv->configInfo.SEW_min;
-    riscvSEWMt     ELEN    = riscv->configInfo.ELEN;
-    riscvSEWMt     VLEN    = riscv->configInfo.VLEN;
-    riscvSEWMt     FRLEN   = (ELEN<VLEN) ? ELEN : VLEN ;
-    riscvSEWMt     SEW     = getVTypeSEW(vtype);
-    riscvVLMULx8Mt VLMULx8 = vtypeToVLMULx8(vtype);
-
-    if(
-        // validate fields that must be zero
-        getVTypeZero(vtype) ||
-        // validate vlmulf setting
-        ((getVTypeSVLMUL(vtype)<0) && !vectorFractLMUL(riscv)) ||
-        // validate agnostic settings
-        ((getVTypeVTA(vtype)||getVTypeVMA(vtype)) && !vectorAgnostic(riscv)) ||
-        // validate SEW is supported
-        (SEW<SEW_min) || (SEW>ELEN) ||
-        // validate LMUL>=(SEW/FRLEN)
-        !(VLMULx8>=((SEW*8)/FRLEN))
-    ) {
-        SEW = SEWMT_UNKNOWN;
+    if(getVTypeZero(vtype)) {
+        return SEWMT_UNKNOWN;
+    } else {
+        return getVTypeInfo(riscv, vtype)->SEW;
     }
-
-    return SEW;
 }
 
 //
@@ -7002,6 +7105,52 @@ static void emitUpdateVTypeVL(riscvMorphStateP state) {
     vmimtRegWriteImpl("vl");
 }
 
+//
+// Is the vtype set by a vsetvli instruction the same as the vtype with which
+// the current block was translated?
+//
+static Bool sameVTypeMT(riscvMorphStateP state) {
+
+    riscvP          riscv    = state->riscv;
+    Uns32           blockKey = riscv->pmKey & PMK_VECTOR;
+    riscvVTypeInfoP info     = getVTypeInfo(riscv, state->info.vtype);
+
+    return (
+        ((blockKey & 3) != VLCLASSMT_UNKNOWN) &&
+        ((blockKey & ~3) == info->pmKey)
+    );
+}
+
+//
+// Terminate the block after a vsetvl/vsetvli instruction because polymorphic
+// state may differ from initial state; if the new vtype could match the
+// current one, the block is left only if the polymorphic key actually changes
+// at run time, so that strip-mined loops need not end the block every time
+//
+static void emitVSetVLEndBlock(riscvMorphStateP state, Bool mayBeSame) {
+
+    if(mayBeSame) {
+
+        riscvP           riscv      = state->riscv;
+        riscvBlockStateP blockState = riscv->blockState;
+        Uns64            nextPC     = state->info.thisPC + state->info.bytes;
+        vmiReg           tmp        = newTmp(state);
+
+        // jump to the next instruction (ending the block) if key differs
+        vmimtCompareRC(16, vmi_COND_NE, RISCV_PM_KEY, riscv->pmKey, tmp);
+        vmimtCondJump(tmp, True, 0, nextPC, VMI_NOREG, vmi_JH_NONE);
+
+        // vl may have changed without changing its class, so knowledge of
+        // registers that have top parts zeroed is no longer valid
+        blockState->VZeroTopMt[VTZ_SINGLE] = 0;
+        blockState->VZeroTopMt[VTZ_GROUP]  = 0;
+
+    } else {
+
+        vmimtEndBlock();
+    }
+}
+
 //
 // Emit VSetVL <rd>, <rs1>, <rs2> embedded function call
 //
@@ -7018,9 +7167,9 @@ static void emitVSetVLRRRCB(riscvMorphStateP state) {
     vmimtCallResultAttrs(cb, dBits, rd.r, VMCA_NO_INVALIDATE);
     writeUnpackedSize(rd, dBits);
 
-    // terminate the block after this instruction because polymorphic state
-    // differs from initial state
-    vmimtEndBlock();
+    // terminate the block after this instruction if polymorphic state differs
+    // from initial state (vtype is not known until run time)
+    emitVSetVLEndBlock(state, True);
 }
 
 //
@@ -7039,9 +7188,9 @@ static void emitVSetVLRRCCB(riscvMorphStateP state) {
     vmimtCallResultAttrs(cb, dBits, rd.r, VMCA_NO_INVALIDATE);
     writeUnpackedSize(rd, dBits);
 
-    // terminate the block after this instruction because polymorphic state
-    // differs from initial state
-    vmimtEndBlock();
+    // terminate the block after this instruction if polymorphic state differs
+    // from initial state
+    emitVSetVLEndBlock(state, sameVTypeMT(state));
 }
 
 //
@@ -7424,6 +7573,112 @@ static RISCV_CHECKV_FN(emitVMVRCheckCB) {
     return ok;
 }
 
+//
+// Attempt a whole-register load or store as a single block transfer between
+// memory and the register group, returning True if successful. The transfer
+// is only done if the entire remaining range is accessible (including any PMP
+// constraints); otherwise the per-element code performs the access and takes
+// any exception with precise vstart.
+//
+static Bool doVLdStWhole(
+    riscvP riscv,
+    Uns64  base,
+    Uns32  vIndex,
+    Uns32  elemBytes,
+    Uns32  bytes,
+    Bool   isStore
+) {
+    Uns32      VLEN     = riscv->configInfo.VLEN;
+    Uns32      offset   = RD_CSR(riscv, vstart)*elemBytes;
+    Uns32      num      = bytes-offset;
+    Uns64      addrMask = getAddressMask(riscvGetXlenMode(riscv));
+    Uns64      addr     = (base+offset) & addrMask;
+    Uns64      end      = addr+num-1;
+    memPriv    priv     = isStore ? MEM_PRIV_W : MEM_PRIV_R;
+    memDomainP domain   = vmirtGetProcessorDataDomain((vmiProcessorP)riscv);
+    Uns8      *v        = (Uns8*)&riscv->v[vIndex*VLEN/32] + offset;
+    Uns64      page;
+
+    if(!riscv->configInfo.unaligned && (addr & (elemBytes-1))) {
+
+        // misaligned element will fault when accessed
+        return False;
+
+    } else if((end & addrMask) < addr) {
+
+        // range wraps at the top of the address space
+        return False;
+    }
+
+    // map each page spanned by the transfer
+    for(page=addr>>RISCV_PAGE_SHIFT; page<=(end>>RISCV_PAGE_SHIFT); page++) {
+
+        Uns64 pageLo = page<<RISCV_PAGE_SHIFT;
+        Uns64 pageHi = pageLo + (1<<RISCV_PAGE_SHIFT) - 1;
+        Uns64 lo     = (addr>pageLo) ? addr : pageLo;
+        Uns64 hi     = (end<pageHi)  ? end  : pageHi;
+
+        if(!riscvVMProbe(riscv, domain, priv, lo, hi-lo+1)) {
+            return False;
+        }
+    }
+
+    // do the transfer
+    if(isStore) {
+        vmirtWriteNByteDomain(domain, addr, v, num, 0, MEM_AA_TRUE);
+    } else {
+        vmirtReadNByteDomain(domain, addr, v, num, 0, MEM_AA_TRUE);
+    }
+
+    return True;
+}
+
+//
+// Emit code to attempt a whole-register load or store as a block transfer,
+// returning a label to which control is transferred if it succeeds (or null
+// if the per-element code must always be used)
+//
+static vmiLabelP emitVLdStWhole(riscvMorphStateP state, iterDescP id) {
+
+    riscvP    riscv     = state->riscv;
+    Uns32     elemBytes = id->SEW/8;
+    vmiLabelP done      = 0;
+
+    if(state->info.isWhole!=RV_WD_LD_ST) {
+        // not a whole-register load or store
+    } else if(riscv->useTMode) {
+        // transaction mode accesses use a distinct domain
+    } else if(id->SLEN!=id->VLEN) {
+        // register layout is striped
+    } else if(
+        (elemBytes>1) &&
+        (riscvGetCurrentDataEndianMT(riscv)!=MEM_ENDIAN_LITTLE)
+    ) {
+        // big-endian elements require byte reversal
+    } else {
+
+        riscvRegDesc vdA     = getRVReg(state, 0);
+        unpackedReg  rs1     = unpackRX(state, 1);
+        Bool         isStore = (state->attrs->vShape==RVVW_V1I_V1I_V1I_ST);
+        vmiReg       ok      = newTmp(state);
+
+        done = vmimtNewLabel();
+
+        vmimtArgProcessor();
+        vmimtArgReg(64, rs1.r);
+        vmimtArgUns32(getRIndex(vdA));
+        vmimtArgUns32(elemBytes);
+        vmimtArgUns32(id->VLEN/8);
+        vmimtArgUns32(isStore);
+        vmimtCallResult((vmiCallFn)doVLdStWhole, 8, ok);
+        vmimtCondJumpLabel(ok, True, done);
+
+        freeTmp(state);
+    }
+
+    return done;
+}
+
 //
 // Operation-specific initialization for loads and stores
 //
@@ -7433,6 +7688,166 @@ static RISCV_MORPHV_FN(emitVLdStInitCB) {
     if(state->info.isFF) {
         vmimtMoveRC(8, RISCV_FF, True);
     }
+
+    // attempt whole-register load/store as a block transfer if required
+    id->whole = emitVLdStWhole(state, id);
+}
+
+//
+// Return the offset held in element i of an index register
+//
+static Uns64 getIndexOffset(Uns8 *index, Uns32 i, Uns32 EEW, Bool sExtend) {
+
+    switch(EEW) {
+        case 8:  return sExtend ? (Int8 )index[i]            : index[i];
+        case 16: return sExtend ? (Int16)((Uns16*)index)[i]  : ((Uns16*)index)[i];
+        case 32: return sExtend ? (Int32)((Uns32*)index)[i]  : ((Uns32*)index)[i];
+        default: return ((Uns64*)index)[i];
+    }
+}
+
+//
+// Add the page to the sorted list of pages already mapped by this instruction,
+// returning False if it was already present
+//
+static Bool addIndexedPage(riscvP riscv, Uns32 *numP, Uns64 page) {
+
+    Uns64 *pages = riscv->vPages;
+    Uns32  lo    = 0;
+    Uns32  hi    = *numP;
+
+    // binary search for page in sorted list
+    while(lo<hi) {
+
+        Uns32 mid = (lo+hi)/2;
+
+        if(pages[mid]==page) {
+            return False;
+        } else if(pages[mid]<page) {
+            lo = mid+1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // insert page at the located position
+    memmove(&pages[lo+1], &pages[lo], (*numP-lo)*sizeof(pages[0]));
+    pages[lo] = page;
+    (*numP)++;
+
+    return True;
+}
+
+//
+// Map pages referenced by active elements of an indexed load/store before the
+// per-element accesses are done, so that each distinct page is translated (and
+// PMP-checked) once. Pages are visited in order of first reference and the
+// scan stops at the first page that cannot be mapped or the first misaligned
+// element: the per-element code then performs accesses in element order and
+// takes any exception with precise vstart.
+//
+static void preMapIndexedPages(
+    riscvP riscv,
+    Uns64  base,
+    Uns32  indexReg,
+    Uns32  EEW,
+    Uns32  elemBytes,
+    Uns32  bytes,
+    Bool   masked,
+    Bool   isStore
+) {
+    Uns32      VLEN     = riscv->configInfo.VLEN;
+    Uns32      vstart   = RD_CSR(riscv, vstart);
+    Uns32      vl       = RD_CSR(riscv, vl);
+    Uns64      addrMask = getAddressMask(riscvGetXlenMode(riscv));
+    Bool       sExtend  = riscvVFSupport(riscv, RVVF_SEXT_IOFFSET);
+    Bool       align    = !riscv->configInfo.unaligned;
+    memPriv    priv     = isStore ? MEM_PRIV_W : MEM_PRIV_R;
+    memDomainP domain   = vmirtGetProcessorDataDomain((vmiProcessorP)riscv);
+    Uns8      *index    = (Uns8*)&riscv->v[indexReg*VLEN/32];
+    Uns8      *mask     = (Uns8*)riscv->v;
+    Uns32      numPages = 0;
+    Uns32      i;
+
+    for(i=vstart; i<vl; i++) {
+
+        if(!masked || ((mask[i/8]>>(i%8)) & 1)) {
+
+            Uns64 offset = getIndexOffset(index, i, EEW, sExtend);
+            Uns64 addr   = (base+offset) & addrMask;
+            Uns64 page   = addr>>RISCV_PAGE_SHIFT;
+            Uns64 last   = (addr+bytes-1)>>RISCV_PAGE_SHIFT;
+
+            // misaligned element will fault when accessed
+            if(align && (addr & (elemBytes-1))) {
+                return;
+            }
+
+            // map each page spanned by the element if not already done
+            for(; page<=last; page++) {
+
+                if(!addIndexedPage(riscv, &numPages, page)) {
+                    // page already mapped by this instruction
+                } else if(!riscvVMProbe(
+                    riscv, domain, priv, page<<RISCV_PAGE_SHIFT, 1
+                )) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+//
+// Emit call to map pages referenced by an indexed load/store if possible
+//
+static void emitPreMapIndexedPages(
+    riscvMorphStateP state,
+    iterDescP        id,
+    Bool             isStore
+) {
+    riscvP       riscv  = state->riscv;
+    riscvRegDesc indexA = getRVReg(state, 2);
+    riscvSEWMt   EEW    = getEEW(id, 2);
+    Bool         masked = state->info.mask ? True : False;
+    Uns32        bytes  = getVMemBits(state, id)/8;
+
+    if(riscv->useTMode) {
+        // not required for transaction mode domain accesses
+    } else if(isIndexedVRegisterStriped(id, 2)) {
+        // index register layout does not allow simple element iteration
+    } else if(masked && (id->MLEN!=1)) {
+        // mask layout does not allow simple element iteration
+    } else {
+
+        unpackedReg rs1 = unpackRX(state, 1);
+
+        vmimtArgProcessor();
+        vmimtArgReg(64, rs1.r);
+        vmimtArgUns32(getRIndex(indexA));
+        vmimtArgUns32(EEW);
+        vmimtArgUns32(bytes);
+        vmimtArgUns32(bytes*(id->nf+1));
+        vmimtArgUns32(masked);
+        vmimtArgUns32(isStore);
+        vmimtCall((vmiCallFn)preMapIndexedPages);
+    }
+}
+
+//
+// Operation-specific initialization for indexed loads
+//
+static RISCV_MORPHV_FN(emitVLdInitXCB) {
+    emitVLdStInitCB(state, id);
+    emitPreMapIndexedPages(state, id, False);
+}
+
+//
+// Operation-specific initialization for indexed stores
+//
+static RISCV_MORPHV_FN(emitVStInitXCB) {
+    emitVLdStInitCB(state, id);
+    emitPreMapIndexedPages(state, id, True);
 }
 
 //
@@ -9689,10 +10104,10 @@ const static riscvMorphAttr dispatchTable[] = {
     // V-extension load/store instructions
     [RV_IT_VL_I]             = {morph:emitVectorOp, opTCB:emitVLdUCB, checkCB:emitVLdStCheckUCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_LD},
     [RV_IT_VLS_I]            = {morph:emitVectorOp, opTCB:emitVLdSCB, checkCB:emitVLdStCheckSCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_LD},
-    [RV_IT_VLX_I]            = {morph:emitVectorOp, opTCB:emitVLdICB, checkCB:emitVLdStCheckXCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_LD},
+    [RV_IT_VLX_I]            = {morph:emitVectorOp, opTCB:emitVLdICB, checkCB:emitVLdStCheckXCB, initCB:emitVLdInitXCB,  vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_LD},
     [RV_IT_VS_I]             = {morph:emitVectorOp, opTCB:emitVStUCB, checkCB:emitVLdStCheckUCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_ST},
     [RV_IT_VSS_I]            = {morph:emitVectorOp, opTCB:emitVStSCB, checkCB:emitVLdStCheckSCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_ST},
-    [RV_IT_VSX_I]            = {morph:emitVectorOp, opTCB:emitVStICB, checkCB:emitVLdStCheckXCB, initCB:emitVLdStInitCB, vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_ST},
+    [RV_IT_VSX_I]            = {morph:emitVectorOp, opTCB:emitVStICB, checkCB:emitVLdStCheckXCB, initCB:emitVStInitXCB,  vstart0:RVVS_ANY, vShape:RVVW_V1I_V1I_V1I_ST},
 
     // V-extension AMO operations (Zvamo)
     [RV_IT_VAMOADD_R]        = {morph:emitVectorOp, opTCB:emitVAMOBinopRRR, checkCB:emitVAMOCheckCB, binop:vmi_ADD,  vstart0:RVVS_ANY},
@@ -10000,6 +10415,11 @@ VMI_MORPH_FN(riscvMorph) {
     riscvP          riscv = (riscvP)processor;
     riscvMorphState state;
 
+    // count translations if profiling the run
+    if(riscv->smpRoot->runProfile) {
+        riscvRunProfileMorph(riscv);
+    }
+
     // get instruction and instruction type
     riscvDecode(riscv, thisPC, &state.info);
 
@@ -10024,6 +10444,12 @@ VMI_MORPH_FN(riscvMorph) {
         state.info.arch |= ISA_FS;
     }
 
+    // commit the previous instruction at the start of this one if running
+    // in lockstep with another model
+    if(riscv->commitRing && !disableMorph(&state)) {
+        riscvCommitRingMorph(riscv, &state.info);
+    }
+
     if(disableMorph(&state)) {
 
         // no action if in disassembly mode
@@ -10071,6 +10497,11 @@ VMI_MORPH_FN(riscvMorph) {
             SRCREF_ARGS(riscv, thisPC)
         );
     }
+
+    // record the register written by the instruction for the commit ring
+    if(riscv->commitRing && !disableMorph(&state)) {
+        riscvCommitRingMorphDone(riscv);
+    }
 }
 
 //
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+// Standard header files
+#include <string.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvPageTracker.h"
+
+
+//
+// This holds the pages written in a domain since tracking was last cleared
+//
+typedef struct riscvPageTrackerS {
+    memDomainP domain;      // tracked physical domain
+    Uns64      mask;        // domain address mask
+    Uns32      numPages;    // number of written pages
+    Uns32      maxPages;    // allocated size of written page list
+    Uns64     *pages;       // written page numbers
+    Uns64     *written;     // set of written page numbers plus one (2*maxPages)
+} riscvPageTracker;
+
+//
+// Return the written page set slot holding the page, or the empty slot where
+// it would be inserted
+//
+static Uns64 *findWrittenSlot(riscvPageTrackerP tracker, Uns64 page) {
+
+    Uns32 mask = tracker->maxPages*2-1;
+    Uns32 i    = ((page*0x9e3779b97f4a7c15ULL) >> 32) & mask;
+
+    while(tracker->written[i] && (tracker->written[i]!=page+1)) {
+        i = (i+1) & mask;
+    }
+
+    return &tracker->written[i];
+}
+
+//
+// Add a page to the written page list if it is not already there
+//
+static void addWrittenPage(riscvPageTrackerP tracker, Uns64 page) {
+
+    Uns64 *slot;
+
+    // grow the written page list and set if required
+    if(tracker->numPages==tracker->maxPages) {
+
+        Uns32  maxPages = tracker->maxPages ? tracker->maxPages*2 : 256;
+        Uns64 *pages    = STYPE_CALLOC_N(Uns64, maxPages);
+        Uns32  i;
+
+        if(tracker->pages) {
+            memcpy(pages, tracker->pages, tracker->numPages*sizeof(*pages));
+            STYPE_FREE(tracker->pages);
+            STYPE_FREE(tracker->written);
+        }
+
+        tracker->pages    = pages;
+        tracker->maxPages = maxPages;
+        tracker->written  = STYPE_CALLOC_N(Uns64, maxPages*2);
+
+        for(i=0; i<tracker->numPages; i++) {
+            *findWrittenSlot(tracker, pages[i]) = pages[i]+1;
+        }
+    }
+
+    // a page already written gets no further entry
+    if(!*(slot=findWrittenSlot(tracker, page))) {
+        *slot = page+1;
+        tracker->pages[tracker->numPages++] = page;
+    }
+}
+
+//
+// Record pages written (defined below)
+//
+static VMI_MEM_WATCH_FN(trackedPageWrite);
+
+//
+// Stop tracking writes to the given page
+//
+static void untrackPage(riscvPageTrackerP tracker, Uns64 page) {
+
+    Uns64 low  = page << RISCV_TRACK_PAGE_SHIFT;
+    Uns64 high = low + RISCV_TRACK_PAGE_BYTES - 1;
+
+    vmirtRemoveWriteCallback(
+        tracker->domain, 0, low, high, trackedPageWrite, tracker
+    );
+}
+
+//
+// Record pages in the given address range as written and stop tracking writes
+// to them, so that subsequent writes to those pages run at full speed
+//
+void riscvAddTrackedPages(riscvPageTrackerP tracker, Uns64 low, Uns64 high) {
+
+    Uns64 first = low  >> RISCV_TRACK_PAGE_SHIFT;
+    Uns64 last  = high >> RISCV_TRACK_PAGE_SHIFT;
+    Uns64 page;
+
+    for(page=first; page<=last; page++) {
+        addWrittenPage(tracker, page);
+        untrackPage(tracker, page);
+    }
+}
+
+//
+// Record pages written
+//
+static VMI_MEM_WATCH_FN(trackedPageWrite) {
+    riscvAddTrackedPages(userData, address, address+bytes-1);
+}
+
+//
+// Allocate a tracker recording the pages written in the given domain
+//
+riscvPageTrackerP riscvNewPageTracker(memDomainP domain) {
+
+    riscvPageTrackerP tracker = STYPE_CALLOC(riscvPageTracker);
+    Uns32             bits    = vmirtGetDomainAddressBits(domain);
+
+    tracker->domain = domain;
+    tracker->mask   = (bits==64) ? -1 : ((1ULL<<bits)-1);
+
+    return tracker;
+}
+
+//
+// Free a page tracker
+//
+void riscvFreePageTracker(riscvPageTrackerP tracker) {
+
+    if(tracker->pages) {
+        STYPE_FREE(tracker->pages);
+        STYPE_FREE(tracker->written);
+    }
+
+    STYPE_FREE(tracker);
+}
+
+//
+// Start tracking writes to all pages not already recorded as written
+//
+void riscvStartPageTracker(riscvPageTrackerP tracker) {
+
+    Uns32 i;
+
+    // remove any remaining callbacks, then cover the whole domain again
+    riscvStopPageTracker(tracker);
+
+    vmirtAddWriteCallback(
+        tracker->domain, 0, 0, tracker->mask, trackedPageWrite, tracker
+    );
+
+    for(i=0; i<tracker->numPages; i++) {
+        untrackPage(tracker, tracker->pages[i]);
+    }
+}
+
+//
+// Stop tracking writes
+//
+void riscvStopPageTracker(riscvPageTrackerP tracker) {
+    vmirtRemoveWriteCallback(
+        tracker->domain, 0, 0, tracker->mask, trackedPageWrite, tracker
+    );
+}
+
+//
+// Forget all pages recorded as written
+//
+void riscvClearTrackedPages(riscvPageTrackerP tracker) {
+
+    tracker->numPages = 0;
+
+    if(tracker->written) {
+        memset(tracker->written, 0, tracker->maxPages*2*sizeof(Uns64));
+    }
+}
+
+//
+// Return the number of pages recorded as written
+//
+Uns32 riscvGetTrackedPageNum(riscvPageTrackerP tracker) {
+    return tracker->numPages;
+}
+
+//
+// Return the base address of the indexed page recorded as written
+//
+Uns64 riscvGetTrackedPage(riscvPageTrackerP tracker, Uns32 index) {
+    return tracker->pages[index] << RISCV_TRACK_PAGE_SHIFT;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Size of tracked pages
+//
+#define RISCV_TRACK_PAGE_SHIFT  12
+#define RISCV_TRACK_PAGE_BYTES  (1<<RISCV_TRACK_PAGE_SHIFT)
+
+//
+// Allocate a tracker recording the pages written in the given domain (writes
+// are not tracked until riscvStartPageTracker is called)
+//
+riscvPageTrackerP riscvNewPageTracker(memDomainP domain);
+
+//
+// Free a page tracker
+//
+void riscvFreePageTracker(riscvPageTrackerP tracker);
+
+//
+// Record pages in the given address range as written and stop tracking writes
+// to them
+//
+void riscvAddTrackedPages(riscvPageTrackerP tracker, Uns64 low, Uns64 high);
+
+//
+// Start tracking writes to all pages not already recorded as written
+//
+void riscvStartPageTracker(riscvPageTrackerP tracker);
+
+//
+// Stop tracking writes
+//
+void riscvStopPageTracker(riscvPageTrackerP tracker);
+
+//
+// Forget all pages recorded as written
+//
+void riscvClearTrackedPages(riscvPageTrackerP tracker);
+
+//
+// Return the number of pages recorded as written
+//
+Uns32 riscvGetTrackedPageNum(riscvPageTrackerP tracker);
+
+//
+// Return the base address of the indexed page recorded as written
+//
+Uns64 riscvGetTrackedPage(riscvPageTrackerP tracker, Uns32 index);
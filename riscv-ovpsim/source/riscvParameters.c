@@ -250,6 +250,29 @@ static vmiEnumParameter FSModes[] = {
     {0}
 };
 
+//
+// Specify TLB save/restore operation
+//
+static vmiEnumParameter TLBSaveModes[] = {
+    [RVTS_EAGER] = {
+        .name        = "eager",
+        .value       = RVTS_EAGER,
+        .description = "TLB contents are saved and all entries are reinserted on restore",
+    },
+    [RVTS_LAZY] = {
+        .name        = "lazy",
+        .value       = RVTS_LAZY,
+        .description = "TLB contents are saved and each entry is reinserted when first used after restore",
+    },
+    [RVTS_NONE] = {
+        .name        = "none",
+        .value       = RVTS_NONE,
+        .description = "TLB contents are not saved and the TLB is empty after restore",
+    },
+    // KEEP LAST: terminator
+    {0}
+};
+
 //
 // Specify Debug mode operation
 //
@@ -278,6 +301,24 @@ static vmiEnumParameter DMModes[] = {
     {0}
 };
 
+//
+// Specify signature word size
+//
+static vmiEnumParameter sigGranularities[] = {
+    {
+        .name        = "4",
+        .value       = 4,
+        .description = "Signature words are 4 bytes",
+    },
+    {
+        .name        = "8",
+        .value       = 8,
+        .description = "Signature words are 8 bytes",
+    },
+    // KEEP LAST: terminator
+    {0}
+};
+
 //
 // Return the maximum number of bits that can be specified for CLICCFGMBITS
 //
@@ -732,11 +773,22 @@ static riscvParameter parameters[] = {
     {  RVPV_ALL,     default_dexc_address,         VMI_UNS64_PARAM_SPEC (riscvParamValues, dexc_address,         0, 0,          -1,         "Specify address to which to jump on debug exception in vectored mode")},
     {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, verbose,              False,                     "Specify verbose output messages")},
     {  RVPV_MPCORE,  default_numHarts,             VMI_UNS32_PARAM_SPEC (riscvParamValues, numHarts,             0, 0,          32,         "Specify the number of hart contexts in a multiprocessor")},
+    {  RVPV_S,       0,                            VMI_ENUM_PARAM_SPEC  (riscvParamValues, TLB_save,             TLBSaveModes,              "Specify how TLB contents are saved and restored (the same value must be used for save and restore)")},
     {  RVPV_S,       default_updatePTEA,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, updatePTEA,           False,                     "Specify whether hardware update of PTE A bit is supported")},
     {  RVPV_S,       default_updatePTED,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, updatePTED,           False,                     "Specify whether hardware update of PTE D bit is supported")},
     {  RVPV_ALL,     default_unaligned,            VMI_BOOL_PARAM_SPEC  (riscvParamValues, unaligned,            False,                     "Specify whether the processor supports unaligned memory accesses")},
     {  RVPV_A,       default_unalignedAMO,         VMI_BOOL_PARAM_SPEC  (riscvParamValues, unalignedAMO,         False,                     "Specify whether the processor supports unaligned memory accesses for AMO instructions")},
     {  RVPV_ALL,     default_wfi_is_nop,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, wfi_is_nop,           False,                     "Specify whether WFI should be treated as a NOP (if not, halt while waiting for interrupts)")},
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, wfi_time_warp,        False,                     "Specify whether simulated time should advance directly to the next known wake-up event when all harts are halted in WFI (requires CLINT_address)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, CLINT_address,        0, 0,          -1,         "Specify base address of internal CLINT model (or 0 if no internal CLINT is required)")},
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, trap_profile,         False,                     "Specify whether trap counts, handler cost and interrupt latency should be profiled and reported at the end of simulation")},
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, semihost_ebreak,      False,                     "Specify whether EBREAK instructions in the standard RISC-V semihosting sequence should perform buffered semihosting operations")},
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, semihost_memops,      False,                     "Specify whether EBREAK semihosting operations 0x100-0x102 perform memcpy, memset and memmove natively (timing and instruction counts are not architectural)")},
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, delta_checkpoint,     False,                     "Specify whether saved state should include physical memory pages written since the previous save or restore (delta checkpoints)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, fork_count,           0, 0,          -1,         "Specify number of child processes to fork after state is restored, each continuing from the restored state (0 if fan-out is not required)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, fork_jobs,            0, 0,          -1,         "Specify maximum number of fan-out child processes running concurrently (0 for no limit)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, fork_index_address,   0, 0,          -1,         "Specify physical address at which each fan-out child writes its 32-bit index (0 if not required)")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, fork_log,             "fork.log",                "Specify file to which each fan-out child redirects its standard output and error; the child index is appended to this name and to the signature_file and run_profile names")},
     {  RVPV_ALL,     default_mtvec_is_ro,          VMI_BOOL_PARAM_SPEC  (riscvParamValues, mtvec_is_ro,          False,                     "Specify whether mtvec CSR is read-only")},
     {  RVPV_ALL,     default_tvec_align,           VMI_UNS32_PARAM_SPEC (riscvParamValues, tvec_align,           0, 0,          (1<<16),    "Specify hardware-enforced alignment of mtvec/stvec/utvec when Vectored interrupt mode enabled")},
     {  RVPV_ALL,     default_counteren_mask,       VMI_UNS32_PARAM_SPEC (riscvParamValues, counteren_mask,       0, 0,          -1,         "Specify hardware-enforced mask of writable bits in mcounteren/scounteren registers")},
@@ -756,6 +808,13 @@ static riscvParameter parameters[] = {
     {  RVPV_ALL,     default_instret_undefined,    VMI_BOOL_PARAM_SPEC  (riscvParamValues, instret_undefined,    False,                     "Specify that the instret CSR is undefined (reads to it are emulated by a Machine mode trap)")},
     {  RVPV_ALL,     default_enable_CSR_bus,       VMI_BOOL_PARAM_SPEC  (riscvParamValues, enable_CSR_bus,       False,                     "Add artifact CSR bus port, allowing CSR registers to be externally implemented")},
     {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, CSR_remap,            "",                        "Comma-separated list of CSR number mappings, each of the form <csrName>=<number>")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, batch_list,           "",                        "File listing ELF files (each optionally followed by a signature file) to run in sequence on the first hart, dumping the signature of each when it writes tohost")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, batch_socket,         "",                        "UNIX socket on which to accept requests to run ELF files in batch mode (after any batch_list entries); each request line gives an ELF file optionally followed by its signature file, and is answered with OK or ERROR when the test completes")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, batch_instruction_limit, 0, 0,       -1,         "Specify the number of instructions after which a batch mode test that has not written tohost fails (0 for no limit)")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, signature_file,       "",                        "File to which the region between begin_signature and end_signature is written, one word per line, when the program writes tohost (simulation then ends) or when simulation ends")},
+    {  RVPV_ALL,     0,                            VMI_ENUM_PARAM_SPEC  (riscvParamValues, signature_granularity, sigGranularities,        "Specify size in bytes of each signature word")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, run_profile,          "",                        "File to which host CPU time for startup, host wall time for program load, simulation and signature dump, simulated instruction and translation counts and peak memory use are written as JSON at the end of simulation")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, commit_ring,          "",                        "Shared memory file to which the PC, encoding, destination register value and CSR write of each retired instruction are written for lockstep comparison with another model")},
     {  RVPV_FP,      default_d_requires_f,         VMI_BOOL_PARAM_SPEC  (riscvParamValues, d_requires_f,         False,                     "If D and F extensions are separately enabled in the misa CSR, whether D is enabled only if F is enabled")},
     {  RVPV_ALL,     default_xret_preserves_lr,    VMI_BOOL_PARAM_SPEC  (riscvParamValues, xret_preserves_lr,    False,                     "Whether an xRET instruction preserves the value of LR")},
     {  RVPV_V,       default_require_vstart0,      VMI_BOOL_PARAM_SPEC  (riscvParamValues, require_vstart0,      False,                     "Whether CSR vstart must be 0 for non-interruptible vector instructions")},
@@ -45,11 +45,22 @@ typedef struct riscvParamValuesS {
     VMI_BOOL_PARAM(debug_mode);
     VMI_UNS64_PARAM(debug_address);
     VMI_UNS64_PARAM(dexc_address);
+    VMI_ENUM_PARAM(TLB_save);
     VMI_BOOL_PARAM(updatePTEA);
     VMI_BOOL_PARAM(updatePTED);
     VMI_BOOL_PARAM(unaligned);
     VMI_BOOL_PARAM(unalignedAMO);
     VMI_BOOL_PARAM(wfi_is_nop);
+    VMI_BOOL_PARAM(wfi_time_warp);
+    VMI_UNS64_PARAM(CLINT_address);
+    VMI_BOOL_PARAM(trap_profile);
+    VMI_BOOL_PARAM(semihost_ebreak);
+    VMI_BOOL_PARAM(semihost_memops);
+    VMI_BOOL_PARAM(delta_checkpoint);
+    VMI_UNS32_PARAM(fork_count);
+    VMI_UNS32_PARAM(fork_jobs);
+    VMI_UNS64_PARAM(fork_index_address);
+    VMI_STRING_PARAM(fork_log);
     VMI_BOOL_PARAM(mtvec_is_ro);
     VMI_UNS32_PARAM(counteren_mask);
     VMI_UNS32_PARAM(noinhibit_mask);
@@ -69,6 +80,13 @@ typedef struct riscvParamValuesS {
     VMI_BOOL_PARAM(instret_undefined);
     VMI_BOOL_PARAM(enable_CSR_bus);
     VMI_STRING_PARAM(CSR_remap);
+    VMI_STRING_PARAM(batch_list);
+    VMI_STRING_PARAM(batch_socket);
+    VMI_UNS64_PARAM(batch_instruction_limit);
+    VMI_STRING_PARAM(signature_file);
+    VMI_ENUM_PARAM(signature_granularity);
+    VMI_STRING_PARAM(run_profile);
+    VMI_STRING_PARAM(commit_ring);
     VMI_BOOL_PARAM(d_requires_f);
     VMI_BOOL_PARAM(xret_preserves_lr);
     VMI_BOOL_PARAM(require_vstart0);
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Standard header files
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvMessage.h"
+#include "riscvRunProfile.h"
+#include "riscvStructure.h"
+
+
+//
+// This holds the run profile for a cluster
+//
+typedef struct riscvRunProfileS {
+    riscvP         hart;                    // hart owning timer and file
+    char          *path;                    // profile file
+    vmiModelTimerP timer;                   // first instruction timer
+    riscvRunPhase  phase;                   // current phase
+    Flt64          phaseStart;              // host time at start of phase
+    Flt64          startup;                 // host CPU time before model
+    Flt64          seconds[RVRP_LAST];      // host wall time in each phase
+    Uns64          instructions;            // instructions simulated
+    Uns64          translations;            // instructions translated
+} riscvRunProfile;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// HOST MEASUREMENTS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return monotonic host time in seconds
+//
+static Flt64 getHostTime(void) {
+
+#ifndef _WIN32
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec/1e9;
+#else
+    return (Flt64)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+//
+// Return host CPU time used by the process so far in seconds
+//
+static Flt64 getProcessTime(void) {
+
+#ifndef _WIN32
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (
+        usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1e6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec/1e6
+    );
+#else
+    return (Flt64)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+//
+// Return peak resident set size of the process in kilobytes
+//
+static Uns64 getPeakRSS(void) {
+
+#ifndef _WIN32
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PHASE TRACKING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the number of instructions executed by all harts at or below the
+// given processor
+//
+static Uns64 getClusterICount(vmiProcessorP processor) {
+
+    vmiProcessorP child = vmirtGetSMPChild(processor);
+    Uns64         count = child ? 0 : vmirtGetICount(processor);
+
+    for(; child; child=vmirtGetSMPNextSibling(child)) {
+        count += getClusterICount(child);
+    }
+
+    return count;
+}
+
+//
+// End the current phase of the run profile and start the given one
+//
+void riscvRunProfilePhase(riscvP riscv, riscvRunPhase phase) {
+
+    riscvRunProfileP profile = riscv->smpRoot->runProfile;
+
+    if(profile && (phase>profile->phase)) {
+
+        Flt64 now = getHostTime();
+
+        profile->seconds[profile->phase] += now-profile->phaseStart;
+
+        // instructions are those executed up to the end of simulation
+        if(profile->phase==RVRP_SIMULATE) {
+            profile->instructions = getClusterICount(
+                (vmiProcessorP)riscv->smpRoot
+            );
+        }
+
+        profile->phase      = phase;
+        profile->phaseStart = now;
+    }
+}
+
+//
+// Count an instruction translation on any hart in the cluster
+//
+void riscvRunProfileMorph(riscvP riscv) {
+    riscv->smpRoot->runProfile->translations++;
+}
+
+//
+// Called before the first instruction, once the program is loaded
+//
+static VMI_ICOUNT_FN(firstInstruction) {
+    riscvRunProfilePhase((riscvP)processor, RVRP_SIMULATE);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR AND DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate run profile data structures for the cluster and start the load
+// phase if a profile file is specified
+//
+void riscvNewRunProfile(riscvP riscv, const char *path) {
+
+    riscvP root = riscv->smpRoot;
+
+    // one profile covers all harts in a cluster
+    if(path && path[0] && !root->runProfile) {
+
+        riscvRunProfileP profile = STYPE_CALLOC(riscvRunProfile);
+
+        profile->hart       = riscv;
+        profile->path       = STYPE_CALLOC_N(char, strlen(path)+1);
+        profile->phase      = RVRP_LOAD;
+        profile->phaseStart = getHostTime();
+        profile->startup    = getProcessTime();
+        profile->timer      = vmirtCreateModelTimer(
+            (vmiProcessorP)riscv, firstInstruction, 1, 0
+        );
+
+        strcpy(profile->path, path);
+
+        root->runProfile = profile;
+
+        vmirtSetModelTimer(profile->timer, 1);
+    }
+}
+
+//
+// Write the run profile as a single-line JSON object
+//
+static void writeRunProfile(riscvRunProfileP profile) {
+
+    FILE *file = fopen(profile->path, "w");
+
+    if(!file) {
+
+        vmiMessage("W", CPU_PREFIX "_RPO",
+            "Cannot open run profile file %s", profile->path
+        );
+
+    } else {
+
+        fprintf(file,
+            "{\"startup_cpu\": %.6f, \"load\": %.6f, \"simulate\": %.6f, "
+            "\"dump\": %.6f, \"instructions\": "FMT_64u", "
+            "\"translations\": "FMT_64u", \"peak_rss_kb\": "FMT_64u"}\n",
+            profile->startup,
+            profile->seconds[RVRP_LOAD],
+            profile->seconds[RVRP_SIMULATE],
+            profile->seconds[RVRP_DUMP],
+            profile->instructions,
+            profile->translations,
+            getPeakRSS()
+        );
+
+        fclose(file);
+    }
+}
+
+//
+// Append a fan-out child index to the run profile file name
+//
+void riscvForkRunProfile(riscvP riscv, Uns32 index) {
+
+    riscvRunProfileP profile = riscv->smpRoot->runProfile;
+
+    if(profile) {
+
+        char *path = STYPE_CALLOC_N(char, strlen(profile->path)+12);
+
+        sprintf(path, "%s.%u", profile->path, index);
+        STYPE_FREE(profile->path);
+
+        profile->path = path;
+    }
+}
+
+//
+// Write and free run profile data structures when the hart that created them
+// is freed
+//
+void riscvFreeRunProfile(riscvP riscv) {
+
+    riscvP           root    = riscv->smpRoot;
+    riscvRunProfileP profile = root->runProfile;
+
+    if(profile && (profile->hart==riscv)) {
+
+        riscvRunProfilePhase(riscv, RVRP_DONE);
+        writeRunProfile(profile);
+
+        vmirtDeleteModelTimer(profile->timer);
+
+        STYPE_FREE(profile->path);
+        STYPE_FREE(profile);
+
+        root->runProfile = 0;
+    }
+}
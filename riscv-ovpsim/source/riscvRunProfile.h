@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Phases of a test run measured by the run profile
+//
+typedef enum riscvRunPhaseE {
+    RVRP_LOAD,          // model construction to first instruction
+    RVRP_SIMULATE,      // first instruction to test completion
+    RVRP_DUMP,          // signature dump
+    RVRP_DONE,          // after the test (not measured)
+    RVRP_LAST           // KEEP LAST: for sizing
+} riscvRunPhase;
+
+//
+// Allocate run profile data structures and start the load phase if a
+// profile file is specified
+//
+void riscvNewRunProfile(riscvP riscv, const char *path);
+
+//
+// End the current phase of the run profile and start the given one
+//
+void riscvRunProfilePhase(riscvP riscv, riscvRunPhase phase);
+
+//
+// Count an instruction translation
+//
+void riscvRunProfileMorph(riscvP riscv);
+
+//
+// Append a fan-out child index to the run profile file name
+//
+void riscvForkRunProfile(riscvP riscv, Uns32 index);
+
+//
+// Write and free run profile data structures
+//
+void riscvFreeRunProfile(riscvP riscv);
+
@@ -17,17 +17,38 @@
  *
  */
 
+// Standard header files
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define dup    _dup
+#define fdopen _fdopen
+#else
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
 // VMI header files
 #include "vmi/vmiAttrs.h"
 #include "vmi/vmiMessage.h"
 #include "vmi/vmiMt.h"
+#include "vmi/vmiRt.h"
 
 // model header files
+#include "riscvDecode.h"
+#include "riscvExceptions.h"
 #include "riscvFunctions.h"
 #include "riscvMorph.h"
 #include "riscvRegisters.h"
+#include "riscvSemiHost.h"
 #include "riscvStructure.h"
 #include "riscvUtils.h"
+#include "riscvVM.h"
+#include "riscvVMConstants.h"
 
 
 //
@@ -94,3 +115,699 @@ VMI_INT_PAR_FN(riscvIntParCB) {
     }
 }
 
+
+
+////////////////////////////////////////////////////////////////////////////////
+// BUFFERED EBREAK SEMIHOSTING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Instructions surrounding EBREAK in the standard semihosting sequence
+//
+#define SEMI_ENTRY_NOP      0x01f01013      // slli x0, x0, 0x1f
+#define SEMI_EXIT_NOP       0x40705013      // srai x0, x0, 7
+
+//
+// Supported semihosting operations
+//
+#define SYS_OPEN            0x01
+#define SYS_CLOSE           0x02
+#define SYS_WRITEC          0x03
+#define SYS_WRITE0          0x04
+#define SYS_WRITE           0x05
+#define SYS_READ            0x06
+#define SYS_READC           0x07
+#define SYS_ISTTY           0x09
+#define SYS_SEEK            0x0A
+#define SYS_FLEN            0x0C
+#define SYS_ERRNO           0x13
+#define SYS_EXIT            0x18
+
+//
+// Accelerated memory operations (user-defined semihosting operation range)
+//
+#define SYS_MEMCPY          0x100
+#define SYS_MEMSET          0x101
+#define SYS_MEMMOVE         0x102
+
+//
+// Reason code indicating normal application exit
+//
+#define ADP_APPLICATION_EXIT 0x20026
+
+//
+// Return number of members of an array
+//
+#define NUM_MEMBERS(_A) (sizeof(_A)/sizeof((_A)[0]))
+
+//
+// Semihosting limits
+//
+#define SEMI_MAX_HANDLES    64              // open file handle limit
+#define SEMI_MAX_NAME       1024            // file name length limit
+#define SEMI_STAGE_BYTES    (64*1024)       // guest transfer chunk size
+#define SEMI_FILE_BUFFER    (1024*1024)     // host file buffer size
+
+//
+// This holds the host file associated with a semihosting handle
+//
+typedef struct semiHandleS {
+    FILE *file;             // host file (NULL if handle is free)
+    Bool  isTTY;            // whether a shared console stream
+} semiHandle;
+
+//
+// This holds buffered semihosting state for a cluster
+//
+typedef struct riscvSemihostS {
+    FILE       *console;                    // buffered console output
+    Int32       lastErrno;                  // host errno of last failure
+    Bool        faulted;                    // memory operation took a trap
+    Bool        warned;                     // memory operation timing warning
+    semiHandle  handles[SEMI_MAX_HANDLES];  // open file handles
+    Uns8        stage[SEMI_STAGE_BYTES];    // guest transfer buffer
+} riscvSemihost;
+
+//
+// Return the cluster semihosting state, creating it if required
+//
+static riscvSemihostP getSemihost(riscvP riscv) {
+
+    riscvP         root = riscv->smpRoot;
+    riscvSemihostP semi = root->semihost;
+
+    if(!semi) {
+
+        semi = root->semihost = STYPE_CALLOC(riscvSemihost);
+
+        // console output is written through a private buffered stream so that
+        // guest output does not cost one host write per call
+        if(!(semi->console = fdopen(dup(fileno(stdout)), "w"))) {
+            semi->console = stdout;
+        } else {
+            setvbuf(semi->console, 0, _IOFBF, SEMI_FILE_BUFFER);
+        }
+    }
+
+    return semi;
+}
+
+//
+// Flush all buffered semihosting output
+//
+static void flushSemihost(riscvSemihostP semi) {
+
+    Uns32 i;
+
+    fflush(semi->console);
+
+    for(i=0; i<SEMI_MAX_HANDLES; i++) {
+        if(semi->handles[i].file && !semi->handles[i].isTTY) {
+            fflush(semi->handles[i].file);
+        }
+    }
+}
+
+//
+// Return the host file for a guest handle (NULL if invalid)
+//
+static FILE *getHandleFile(riscvSemihostP semi, Uns64 handle) {
+    return (handle<SEMI_MAX_HANDLES) ? semi->handles[handle].file : 0;
+}
+
+//
+// Return the size in bytes of a semihosting parameter block field
+//
+inline static Uns32 getFieldBytes(riscvP riscv) {
+    return getRegBits(riscv)/8;
+}
+
+//
+// Return the data domain used for semihosting transfers
+//
+inline static memDomainP getSemiDomain(riscvP riscv) {
+    return vmirtGetProcessorDataDomain((vmiProcessorP)riscv);
+}
+
+//
+// Read field from semihosting parameter block
+//
+static Uns64 readField(riscvP riscv, Uns64 block, Uns32 index) {
+
+    memDomainP domain = getSemiDomain(riscv);
+    Uns32      bytes  = getFieldBytes(riscv);
+    Addr       addr   = block + (index*bytes);
+    memEndian  endian = MEM_ENDIAN_LITTLE;
+
+    if(bytes==4) {
+        return vmirtRead4ByteDomain(domain, addr, endian, MEM_AA_FALSE);
+    } else {
+        return vmirtRead8ByteDomain(domain, addr, endian, MEM_AA_FALSE);
+    }
+}
+
+//
+// Read byte from guest memory
+//
+static Uns8 readByte(riscvP riscv, Uns64 addr) {
+
+    Uns8 result = 0;
+
+    vmirtReadNByteDomain(
+        getSemiDomain(riscv), addr, &result, 1, 0, MEM_AA_FALSE
+    );
+
+    return result;
+}
+
+//
+// Write guest buffer to host file in staged chunks, returning the number of
+// bytes NOT written
+//
+static Uns64 writeGuest(
+    riscvP         riscv,
+    riscvSemihostP semi,
+    FILE          *file,
+    Uns64          buffer,
+    Uns64          length
+) {
+    memDomainP domain = getSemiDomain(riscv);
+
+    while(length) {
+
+        Uns32 chunk = (length>SEMI_STAGE_BYTES) ? SEMI_STAGE_BYTES : length;
+
+        vmirtReadNByteDomain(
+            domain, buffer, semi->stage, chunk, 0, MEM_AA_FALSE
+        );
+
+        if(fwrite(semi->stage, 1, chunk, file)!=chunk) {
+            semi->lastErrno = errno;
+            break;
+        }
+
+        buffer += chunk;
+        length -= chunk;
+    }
+
+    return length;
+}
+
+//
+// Read host file into guest buffer in staged chunks, returning the number of
+// bytes NOT read
+//
+static Uns64 readGuest(
+    riscvP         riscv,
+    riscvSemihostP semi,
+    FILE          *file,
+    Uns64          buffer,
+    Uns64          length
+) {
+    memDomainP domain = getSemiDomain(riscv);
+
+    while(length) {
+
+        Uns32 chunk = (length>SEMI_STAGE_BYTES) ? SEMI_STAGE_BYTES : length;
+        Uns32 got   = fread(semi->stage, 1, chunk, file);
+
+        vmirtWriteNByteDomain(
+            domain, buffer, semi->stage, got, 0, MEM_AA_FALSE
+        );
+
+        buffer += got;
+        length -= got;
+
+        if(got!=chunk) {
+            semi->lastErrno = ferror(file) ? errno : 0;
+            break;
+        }
+    }
+
+    return length;
+}
+
+//
+// Implement SYS_OPEN
+//
+static Int64 semiOpen(riscvP riscv, riscvSemihostP semi, Uns64 block) {
+
+    static const char *modes[] = {
+        "r", "rb", "r+", "r+b", "w", "wb", "w+", "w+b", "a", "ab", "a+", "a+b"
+    };
+
+    Uns64 nameAddr = readField(riscv, block, 0);
+    Uns64 mode     = readField(riscv, block, 1);
+    Uns64 nameLen  = readField(riscv, block, 2);
+    char  name[SEMI_MAX_NAME];
+    FILE *file;
+    Bool  isTTY;
+    Uns32 i;
+
+    if((mode>=NUM_MEMBERS(modes)) || (nameLen>=SEMI_MAX_NAME)) {
+        semi->lastErrno = EINVAL;
+        return -1;
+    }
+
+    vmirtReadNByteDomain(
+        getSemiDomain(riscv), nameAddr, name, nameLen, 0, MEM_AA_FALSE
+    );
+    name[nameLen] = 0;
+
+    // ":tt" selects the console (stdin for read modes, stdout otherwise)
+    if((isTTY=!strcmp(name, ":tt"))) {
+        file = (mode<4) ? stdin : (mode<8) ? semi->console : stderr;
+    } else if(!(file=fopen(name, modes[mode]))) {
+        semi->lastErrno = errno;
+        return -1;
+    } else {
+        setvbuf(file, 0, _IOFBF, SEMI_FILE_BUFFER);
+    }
+
+    // allocate a handle
+    for(i=0; i<SEMI_MAX_HANDLES; i++) {
+        if(!semi->handles[i].file) {
+            semi->handles[i].file  = file;
+            semi->handles[i].isTTY = isTTY;
+            return i;
+        }
+    }
+
+    // no free handle
+    if(!isTTY) {
+        fclose(file);
+    }
+    semi->lastErrno = EMFILE;
+
+    return -1;
+}
+
+//
+// Implement SYS_CLOSE
+//
+static Int64 semiClose(riscvSemihostP semi, Uns64 handle) {
+
+    FILE *file = getHandleFile(semi, handle);
+
+    if(!file) {
+        semi->lastErrno = EBADF;
+        return -1;
+    }
+
+    if(!semi->handles[handle].isTTY) {
+        fclose(file);
+    }
+
+    semi->handles[handle].file = 0;
+
+    return 0;
+}
+
+//
+// Validate that the guest range can be accessed with the given privilege,
+// taking the appropriate Page Fault or Access Fault exception if not. Every
+// page is checked before any data is transferred, so that a faulting
+// operation has no side effects and is restarted when the handler returns.
+// The exception is taken at the first inaccessible byte. The operation is
+// marked as faulted only if an exception was actually taken (a custom
+// extension may suppress it).
+//
+static Bool checkRange(
+    riscvP         riscv,
+    riscvSemihostP semi,
+    memDomainP     domain,
+    memPriv        priv,
+    Uns64          addr,
+    Uns64          bytes
+) {
+    Uns64 end = addr+bytes-1;
+    Uns64 page;
+
+    for(page=addr>>RISCV_PAGE_SHIFT; page<=(end>>RISCV_PAGE_SHIFT); page++) {
+
+        Uns64 pageLo = page<<RISCV_PAGE_SHIFT;
+        Uns64 pageHi = pageLo + RISCV_PAGE_SIZE - 1;
+        Uns64 lo     = (addr>pageLo) ? addr : pageLo;
+        Uns64 hi     = (end<pageHi)  ? end  : pageHi;
+
+        if(!riscvVMProbe(riscv, domain, priv, lo, hi-lo+1)) {
+
+            riscvException last = riscv->exception;
+
+            // locate the first inaccessible byte (a PMP region may end
+            // within the page)
+            while((lo<hi) && riscvVMProbe(riscv, domain, priv, lo, 1)) {
+                lo++;
+            }
+
+            // repeat the lookup outside probe context to take any exception
+            // raised by address translation
+            riscv->exception = 0;
+            riscvVMMiss(riscv, domain, priv, lo, hi-lo+1, MEM_AA_TRUE);
+
+            // a PMP or PMA failure raises no exception in the lookup, so take
+            // the Access Fault here
+            if(!riscv->exception) {
+                riscvTakeMemoryException(
+                    riscv,
+                    (priv==MEM_PRIV_R) ?
+                        riscv_E_LoadAccessFault :
+                        riscv_E_StoreAMOAccessFault,
+                    lo
+                );
+            }
+
+            if(riscv->exception) {
+                semi->faulted = True;
+            } else {
+                riscv->exception = last;
+            }
+
+            return False;
+        }
+    }
+
+    return True;
+}
+
+//
+// Implement SYS_MEMCPY, SYS_MEMSET and SYS_MEMMOVE natively, returning the
+// destination address
+//
+static Int64 semiMemOp(
+    riscvP         riscv,
+    riscvSemihostP semi,
+    Uns32          op,
+    Uns64          block
+) {
+    memDomainP     domain = getSemiDomain(riscv);
+    Uns64          mask   = (getRegBits(riscv)==32) ? 0xffffffffULL : -1ULL;
+    Uns64          dst    = readField(riscv, block, 0) & mask;
+    Uns64          src    = readField(riscv, block, 1) & mask;
+    Uns64          length = readField(riscv, block, 2);
+    Bool           isSet  = (op==SYS_MEMSET);
+    Bool           down   = !isSet && (dst>src) && (dst<(src+length));
+    Uns64          done   = 0;
+    riscvException last;
+
+    if(!riscv->configInfo.semihost_memops) {
+        semi->lastErrno = ENOSYS;
+        return -1;
+    }
+
+    // warn once that these operations take no simulated time
+    if(!semi->warned) {
+        semi->warned = True;
+        vmiMessage("W", CPU_PREFIX"_NAT",
+            "accelerated memory operations are performed natively: "
+            "instruction counts and timing are not architectural"
+        );
+    }
+
+    if(!length) {
+        return dst;
+    }
+
+    // ranges that wrap must be handled by guest code
+    if(
+        (((dst+length-1) & mask) < dst) ||
+        (!isSet && (((src+length-1) & mask) < src))
+    ) {
+        semi->lastErrno = EINVAL;
+        return -1;
+    }
+
+    // check all pages before modifying memory
+    if(
+        (!isSet && !checkRange(riscv, semi, domain, MEM_PRIV_R, src, length)) ||
+        !checkRange(riscv, semi, domain, MEM_PRIV_W, dst, length)
+    ) {
+        semi->lastErrno = EFAULT;
+        return -1;
+    }
+
+    if(isSet) {
+        memset(semi->stage, src, SEMI_STAGE_BYTES);
+    }
+
+    // detect any exception taken by the transfer itself
+    last             = riscv->exception;
+    riscv->exception = 0;
+
+    // transfer in chunks, working downwards if an overlapping move requires
+    while(done<length) {
+
+        Uns64 remain = length-done;
+        Uns32 chunk  = (remain>SEMI_STAGE_BYTES) ? SEMI_STAGE_BYTES : remain;
+        Uns64 offset = down ? remain-chunk : done;
+
+        if(!isSet) {
+            vmirtReadNByteDomain(
+                domain, src+offset, semi->stage, chunk, 0, MEM_AA_TRUE
+            );
+        }
+
+        if(!riscv->exception) {
+            vmirtWriteNByteDomain(
+                domain, dst+offset, semi->stage, chunk, 0, MEM_AA_TRUE
+            );
+        }
+
+        // an access that faulted despite the checks above has taken its
+        // exception: abandon the operation so that EBREAK is restarted
+        if(riscv->exception) {
+            semi->faulted   = True;
+            semi->lastErrno = EFAULT;
+            return -1;
+        }
+
+        done += chunk;
+    }
+
+    riscv->exception = last;
+
+    return dst;
+}
+
+//
+// Implement SYS_EXIT
+//
+static void semiExit(riscvP riscv, riscvSemihostP semi, Uns64 arg) {
+
+    Uns64 reason = arg;
+    Int32 status = 0;
+
+    // on 64-bit targets the argument addresses a (reason, subcode) block
+    if(getFieldBytes(riscv)==8) {
+        reason = readField(riscv, arg, 0);
+        status = readField(riscv, arg, 1);
+    } else if(reason!=ADP_APPLICATION_EXIT) {
+        status = 1;
+    }
+
+    flushSemihost(semi);
+
+    vmirtFinish(status);
+}
+
+//
+// Perform semihosting operation, returning the result for register a0
+//
+static Int64 doSemihost(riscvP riscv, Uns64 op, Uns64 arg) {
+
+    riscvSemihostP semi = getSemihost(riscv);
+    FILE          *file;
+    Uns64          handle;
+    Uns8           ch;
+
+    switch(op) {
+
+        case SYS_OPEN:
+            return semiOpen(riscv, semi, arg);
+
+        case SYS_CLOSE:
+            return semiClose(semi, readField(riscv, arg, 0));
+
+        case SYS_WRITEC:
+            return writeGuest(riscv, semi, semi->console, arg, 1);
+
+        case SYS_WRITE0:
+            while((ch=readByte(riscv, arg++))) {
+                fputc(ch, semi->console);
+            }
+            return 0;
+
+        case SYS_WRITE:
+            if(!(file=getHandleFile(semi, readField(riscv, arg, 0)))) {
+                semi->lastErrno = EBADF;
+                return -1;
+            }
+            return writeGuest(
+                riscv, semi, file,
+                readField(riscv, arg, 1), readField(riscv, arg, 2)
+            );
+
+        case SYS_READ:
+            if(!(file=getHandleFile(semi, readField(riscv, arg, 0)))) {
+                semi->lastErrno = EBADF;
+                return -1;
+            }
+            if(file==stdin) {
+                fflush(semi->console);
+            }
+            return readGuest(
+                riscv, semi, file,
+                readField(riscv, arg, 1), readField(riscv, arg, 2)
+            );
+
+        case SYS_READC:
+            fflush(semi->console);
+            return getchar();
+
+        case SYS_ISTTY:
+            if(!(file=getHandleFile(semi, handle=readField(riscv, arg, 0)))) {
+                semi->lastErrno = EBADF;
+                return -1;
+            }
+            return semi->handles[handle].isTTY;
+
+        case SYS_SEEK:
+            if(!(file=getHandleFile(semi, readField(riscv, arg, 0)))) {
+                semi->lastErrno = EBADF;
+                return -1;
+            } else if(fseek(file, readField(riscv, arg, 1), SEEK_SET)) {
+                semi->lastErrno = errno;
+                return -1;
+            }
+            return 0;
+
+        case SYS_FLEN: {
+            long here, size;
+            if(!(file=getHandleFile(semi, readField(riscv, arg, 0)))) {
+                semi->lastErrno = EBADF;
+                return -1;
+            }
+            here = ftell(file);
+            fseek(file, 0, SEEK_END);
+            size = ftell(file);
+            fseek(file, here, SEEK_SET);
+            return size;
+        }
+
+        case SYS_ERRNO:
+            return semi->lastErrno;
+
+        case SYS_EXIT:
+            semiExit(riscv, semi, arg);
+            return 0;
+
+        case SYS_MEMCPY:
+        case SYS_MEMSET:
+        case SYS_MEMMOVE:
+            return semiMemOp(riscv, semi, op, arg);
+
+        default:
+            vmiMessage("W", CPU_PREFIX"_UOP",
+                "unsupported semihosting operation 0x"FMT_Ax, op
+            );
+            return -1;
+    }
+}
+
+//
+// If buffered EBREAK semihosting is enabled and the EBREAK at the current PC
+// is part of the standard semihosting sequence, perform the operation and
+// return True; otherwise return False
+//
+Bool riscvSemihostEBREAK(riscvP riscv) {
+
+    vmiProcessorP processor = (vmiProcessorP)riscv;
+    Uns64         thisPC    = vmirtGetPC(processor);
+    Bool          result    = False;
+
+    if(
+        riscv->configInfo.semihost_ebreak &&
+        (riscvFetchInstruction(riscv, thisPC-4, 0)==SEMI_ENTRY_NOP) &&
+        (riscvFetchInstruction(riscv, thisPC+4, 0)==SEMI_EXIT_NOP)
+    ) {
+        riscvSemihostP semi  = getSemihost(riscv);
+        Int64          value = doSemihost(riscv, riscv->x[10], riscv->x[11]);
+
+        if(semi->faulted) {
+
+            // operation took an exception: EBREAK is restarted on return
+            semi->faulted = False;
+
+        } else {
+
+            // results are sign-extended from XLEN
+            if(getRegBits(riscv)==32) {
+                value = (Int32)value;
+            }
+
+            riscv->x[10] = value;
+
+            // resume after the closing semihosting NOP
+            vmirtSetPC(processor, thisPC+8);
+        }
+
+        result = True;
+    }
+
+    return result;
+}
+
+//
+// Flush buffered semihosting output and close all guest file handles, so that
+// the next program starts with no semihosting state
+//
+void riscvResetSemihost(riscvP riscv) {
+
+    riscvSemihostP semi = riscv->smpRoot->semihost;
+
+    if(semi) {
+
+        Uns32 i;
+
+        fflush(semi->console);
+
+        for(i=0; i<SEMI_MAX_HANDLES; i++) {
+
+            if(semi->handles[i].file && !semi->handles[i].isTTY) {
+                fclose(semi->handles[i].file);
+            }
+
+            semi->handles[i].file = 0;
+        }
+
+        semi->lastErrno = 0;
+        semi->faulted   = False;
+    }
+}
+
+//
+// Flush and free buffered semihosting state
+//
+void riscvFreeSemihost(riscvP riscv) {
+
+    riscvSemihostP semi = riscv->semihost;
+
+    if(semi) {
+
+        Uns32 i;
+
+        for(i=0; i<SEMI_MAX_HANDLES; i++) {
+            if(semi->handles[i].file && !semi->handles[i].isTTY) {
+                fclose(semi->handles[i].file);
+            }
+        }
+
+        if(semi->console!=stdout) {
+            fclose(semi->console);
+        }
+
+        STYPE_FREE(semi);
+
+        riscv->semihost = 0;
+    }
+}
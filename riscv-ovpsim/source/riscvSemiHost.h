@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// If buffered EBREAK semihosting is enabled and the EBREAK at the current PC
+// is part of the standard semihosting sequence, perform the operation and
+// return True; otherwise return False
+//
+Bool riscvSemihostEBREAK(riscvP riscv);
+
+//
+// Flush buffered semihosting output and close all guest file handles, so that
+// the next program starts with no semihosting state
+//
+void riscvResetSemihost(riscvP riscv);
+
+//
+// Flush and free buffered semihosting state
+//
+void riscvFreeSemihost(riscvP riscv);
+
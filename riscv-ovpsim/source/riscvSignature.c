@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Standard header files
+#include <stdio.h>
+#include <string.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvMessage.h"
+#include "riscvRunProfile.h"
+#include "riscvSignature.h"
+#include "riscvStructure.h"
+
+
+//
+// Size of signature region read in a single access
+//
+#define SIG_CHUNK_BYTES     4096
+
+//
+// This holds signature dump state for a hart
+//
+typedef struct riscvSignatureS {
+    char          *path;        // signature file
+    vmiModelTimerP timer;       // setup and completion timer
+    memDomainP     domain;      // physical domain
+    Uns64          begin;       // begin_signature address
+    Uns64          end;         // end_signature address
+    Uns64          tohost;      // tohost address
+    Bool           armed;       // symbols have been looked up
+    Bool           found;       // signature symbols found
+    Bool           done;        // signature written
+} riscvSignature;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SIGNATURE OUTPUT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Write the signature region [begin,end) to the named file, one little-endian
+// word of the given size per line, returning True on success
+//
+Bool riscvWriteSignature(
+    memDomainP  domain,
+    Uns64       begin,
+    Uns64       end,
+    Uns32       wordBytes,
+    const char *path
+) {
+    FILE *file = fopen(path, "w");
+
+    if(!file) {
+
+        vmiMessage("W", CPU_PREFIX "_SGO",
+            "Cannot open signature file %s", path
+        );
+
+        return False;
+
+    } else {
+
+        Uns8  buffer[SIG_CHUNK_BYTES];
+        Uns64 addr;
+
+        // stream region in chunks that are a whole number of words
+        for(addr=begin; addr<end; addr+=SIG_CHUNK_BYTES) {
+
+            Uns64 remain = end-addr;
+            Uns32 chunk  = (remain<SIG_CHUNK_BYTES) ? remain : SIG_CHUNK_BYTES;
+            Uns32 offset;
+
+            vmirtReadNByteDomain(domain, addr, buffer, chunk, 0, MEM_AA_FALSE);
+
+            for(offset=0; offset+wordBytes<=chunk; offset+=wordBytes) {
+
+                Uns64 word = 0;
+                Uns32 i    = wordBytes;
+
+                while(i--) {
+                    word = (word<<8) | buffer[offset+i];
+                }
+
+                if(wordBytes==8) {
+                    fprintf(file, "%08x", (Uns32)(word>>32));
+                }
+
+                fprintf(file, "%08x\n", (Uns32)word);
+            }
+        }
+
+        fclose(file);
+
+        return True;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STANDALONE SIGNATURE DUMP
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the word size of signature dumps for the hart
+//
+inline static Uns32 getWordBytes(riscvP riscv) {
+    return riscv->configInfo.signature_granularity;
+}
+
+//
+// Look up the address of the named symbol, returning True if it is found
+//
+static Bool findSymbol(riscvP riscv, const char *name, Uns64 *addressP) {
+
+    vmiSymbolCP symbol = vmirtGetSymbolByName((vmiProcessorP)riscv, name);
+
+    if(symbol) {
+        *addressP = vmirtGetSymbolAddr(symbol);
+    }
+
+    return symbol ? True : False;
+}
+
+//
+// Write the signature if it has been located and not yet written
+//
+static void dumpSignature(riscvP riscv, riscvSignatureP sig) {
+
+    if(sig->found && !sig->done) {
+
+        riscvRunProfilePhase(riscv, RVRP_DUMP);
+
+        riscvWriteSignature(
+            sig->domain, sig->begin, sig->end, getWordBytes(riscv), sig->path
+        );
+
+        riscvRunProfilePhase(riscv, RVRP_DONE);
+
+        sig->done = True;
+    }
+}
+
+//
+// Called when the test writes tohost: complete the test before the next
+// instruction
+//
+static VMI_MEM_WATCH_FN(tohostWrite) {
+
+    riscvSignatureP sig = userData;
+
+    vmirtSetModelTimer(sig->timer, 1);
+}
+
+//
+// Called before the first instruction (once the program is loaded) to locate
+// the signature region and watch tohost, and again when tohost is written to
+// write the signature and terminate simulation
+//
+static VMI_ICOUNT_FN(signatureTimer) {
+
+    riscvP          riscv = (riscvP)processor;
+    riscvSignatureP sig   = riscv->signature;
+
+    if(!sig->armed) {
+
+        sig->armed  = True;
+        sig->domain = riscv->physDomains[RISCV_MODE_M][0];
+        sig->found  = (
+            findSymbol(riscv, "begin_signature", &sig->begin) &&
+            findSymbol(riscv, "end_signature",   &sig->end)
+        );
+
+        if(!sig->found) {
+
+            vmiMessage("W", CPU_PREFIX "_SGS",
+                "begin_signature or end_signature symbol not found - "
+                "no signature will be written"
+            );
+
+        } else if(findSymbol(riscv, "tohost", &sig->tohost)) {
+
+            vmirtAddWriteCallback(
+                sig->domain, 0, sig->tohost, sig->tohost+7, tohostWrite, sig
+            );
+        }
+
+    } else {
+
+        dumpSignature(riscv, sig);
+
+        vmirtFinish(0);
+    }
+}
+
+//
+// Schedule signature dump setup if a signature file is specified
+//
+void riscvNewSignature(riscvP riscv, const char *path) {
+
+    if(path && path[0]) {
+
+        riscvSignatureP sig = STYPE_CALLOC(riscvSignature);
+
+        sig->path  = STYPE_CALLOC_N(char, strlen(path)+1);
+        sig->timer = vmirtCreateModelTimer(
+            (vmiProcessorP)riscv, signatureTimer, 1, 0
+        );
+
+        strcpy(sig->path, path);
+
+        riscv->signature = sig;
+
+        vmirtSetModelTimer(sig->timer, 1);
+    }
+}
+
+//
+// Append a fan-out child index to the signature file name
+//
+void riscvForkSignature(riscvP riscv, Uns32 index) {
+
+    riscvSignatureP sig = riscv->signature;
+
+    if(sig) {
+
+        char *path = STYPE_CALLOC_N(char, strlen(sig->path)+12);
+
+        sprintf(path, "%s.%u", sig->path, index);
+        STYPE_FREE(sig->path);
+
+        sig->path = path;
+    }
+}
+
+//
+// Write any outstanding signature and free signature dump data structures
+//
+void riscvFreeSignature(riscvP riscv) {
+
+    riscvSignatureP sig = riscv->signature;
+
+    if(sig) {
+
+        // simulation ended by other means (for example, a semihosting exit)
+        dumpSignature(riscv, sig);
+
+        vmirtDeleteModelTimer(sig->timer);
+
+        STYPE_FREE(sig->path);
+        STYPE_FREE(sig);
+
+        riscv->signature = 0;
+    }
+}
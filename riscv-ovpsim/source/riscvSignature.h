@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+
+//
+// Write the signature region [begin,end) to the named file, one little-endian
+// word of the given size per line, returning True on success
+//
+Bool riscvWriteSignature(
+    memDomainP  domain,
+    Uns64       begin,
+    Uns64       end,
+    Uns32       wordBytes,
+    const char *path
+);
+
+//
+// Schedule signature dump setup if a signature file is specified
+//
+void riscvNewSignature(riscvP riscv, const char *path);
+
+//
+// Write any outstanding signature and free signature dump data structures
+//
+void riscvFreeSignature(riscvP riscv);
+
+//
+// Append a fan-out child index to the signature file name
+//
+void riscvForkSignature(riscvP riscv, Uns32 index);
@@ -100,6 +100,20 @@ typedef struct riscvPendEnabS {
     Bool      isCLIC;   // whether CLIC mode interrupt
 } riscvPendEnab;
 
+//
+// This holds the basic mode pending-and-enabled mask, with the bits whose
+// state may have changed since it was computed, and the most-recent interrupt
+// selection, which is reused while the mask, current mode and delegation of
+// the contributing interrupts are unchanged
+//
+typedef struct riscvIntSelectS {
+    Uns64         pendingEnabled;   // pending-and-enabled mask
+    Uns64         stale;            // bits of mask that must be recomputed
+    riscvMode     mode;             // mode in which selection was made
+    Bool          dirty;            // whether selection must be recomputed
+    riscvPendEnab selected;         // selected interrupt
+} riscvIntSelect;
+
 //
 // This holds all state contributing to a basic mode interrupt (for debug)
 //
@@ -161,6 +175,12 @@ typedef riscvDomainSetVM *riscvDomainSetVMP;
 #define LMUL_MAX        8
 #define NUM_BASE_REGS   4
 
+//
+// Number of distinct vtype encodings with always-zero fields clear (vector
+// extension)
+//
+#define VTYPE_INFO_NUM  256
+
 //
 // Processor model structure
 //
@@ -216,6 +236,7 @@ typedef struct riscvS {
     Uns64              exceptionMask;   // mask of all implemented exceptions
     Uns64              interruptMask;   // mask of all implemented interrupts
     riscvPendEnab      pendEnab;        // pending and enabled interrupt
+    riscvIntSelect     intSelect;       // cached basic interrupt selection
     Uns32              extInt[RISCV_MODE_LAST]; // external interrupt override
     riscvCLIC          clic;            // source interrupt indicated from CLIC
     riscvException     exception : 16;  // last activated exception
@@ -233,9 +254,12 @@ typedef struct riscvS {
     // Counter/timer support
     Uns64              baseCycles;      // base cycle count
     Uns64              baseInstructions;// base instruction count
+    Uns64              timeWarp;        // time skipped by WFI time warp
+    Uns64              cycleWarp;       // cycles skipped by WFI time warp
 
     // Debug
     vmiRegInfoP        regInfo[2];      // register views (normal and debug)
+    riscvSnapLayoutP   snapLayout;      // packed register snapshot layout
 
     // Parameters
     vmiEnumParameterP  variantList;     // supported variants
@@ -258,6 +282,26 @@ typedef struct riscvS {
     // Timers
     vmiModelTimerP     stepTimer;       // Debug mode single-step timer
 
+    // CLINT support
+    riscvPP            CLINTHarts;      // member harts (cluster root only)
+    Uns64              mtimecmp;        // CLINT mtimecmp register
+    Bool               msip;            // CLINT msip register
+    vmiModelTimerP     mtimecmpTimer;   // CLINT mtimecmp expiry timer
+    vmiModelTimerP     forkTimer;       // fan-out after restore timer
+    char              *forkLog;         // fan-out child output file
+
+    // Trap profiling
+    riscvTrapProfileP  trapProfile;     // trap and interrupt profile
+    riscvRunProfileP   runProfile;      // test run profile (cluster root)
+    riscvCommitRingP   commitRing;      // co-simulation commit ring
+
+    // Buffered semihosting
+    riscvSemihostP     semihost;        // semihosting state (cluster root)
+
+    // Batch mode and signature dump
+    riscvBatchP        batch;           // batch mode state
+    riscvSignatureP    signature;       // standalone signature dump state
+
     // CSR support
     vmiRangeTableP     csrTable;        // per-CSR lookup table
     vmiRangeTableP     csrUIMessage;    // per-CSR unimplemented messages
@@ -271,6 +315,8 @@ typedef struct riscvS {
     riscvDomainSetVM   vmDomains;       // mapped domains (per virtual mode)
     memDomainP         tmDomain;        // transaction mode domain
     memDomainP         CLICDomain;      // CLIC domain
+    memDomainP         CLINTDomain;     // CLINT domain
+    riscvDeltaCPP      deltaCP;         // delta checkpoint dirty pages
     riscvPMPCFG        pmpcfg;          // pmpcfg registers
     Uns64             *pmpaddr;         // pmpaddr registers
     riscvTLBP          tlb[RISCV_TLB_LAST];// TLB caches
@@ -281,6 +327,8 @@ typedef struct riscvS {
     Bool               PTWBadAddr : 1;  // page table walk address was bad
     Bool               s2Active   : 1;  // stage 2 access active
     Bool               GVA        : 1;  // is guest virtual address?
+    Bool               VMProbe    : 1;  // mapping probe active (no exceptions)
+    Bool               VMProbeFail: 1;  // mapping probe failed
     Uns64              GPA;             // faulting guest physical address
     Uns64              s1VA;            // stage 1 VA in stage 2 context
 
@@ -302,6 +350,8 @@ typedef struct riscvS {
     Uns64              vTmp;                 	// vector operation temporary
     UnsPS              vBase[NUM_BASE_REGS];  	// indexed base registers
     Uns32             *v;                     	// vector registers (configurable size)
+    riscvVTypeInfoP    vtypeInfo;               // precomputed vtype information
+    Uns64             *vPages;                  // distinct pages (indexed access)
 
 } riscv;
 
@@ -401,6 +451,13 @@ inline static Bool CLICExternal(riscvP riscv) {
     return CLICPresent(riscv) && riscv->configInfo.externalCLIC;
 }
 
+//
+// Is CLINT present and implemented internally?
+//
+inline static Bool CLINTInternal(riscvP riscv) {
+    return riscv->configInfo.CLINT_address;
+}
+
 //
 // Is basic interrupt controller present?
 //
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvExceptions.h"
+#include "riscvMessage.h"
+#include "riscvStructure.h"
+#include "riscvTrapProfile.h"
+#include "riscvUtils.h"
+
+
+//
+// Number of synchronous exception codes tracked
+//
+#define RISCV_TP_EXCEPT_NUM     64
+
+//
+// Number of log2 histogram buckets (bucket 0 holds zero values)
+//
+#define RISCV_TP_BUCKETS        65
+
+//
+// Maximum trap nesting depth for which handler cost is measured
+//
+#define RISCV_TP_MAX_NEST       16
+
+//
+// Value indicating an interrupt input is not asserted
+//
+#define RISCV_TP_NOT_RAISED     ((Uns64)-1)
+
+//
+// riscvTrapFrame opaque type pointer
+//
+DEFINE_S(riscvTrapFrame);
+
+//
+// This holds state for an active (not yet returned) trap
+//
+typedef struct riscvTrapFrameS {
+    Uns64          entryCount;  // executed instruction count at entry
+    riscvException exception;   // trap cause
+} riscvTrapFrame;
+
+//
+// This holds a histogram of measured values
+//
+typedef struct riscvTrapHistS {
+    Uns64 num;                          // number of samples
+    Uns64 total;                        // total of all samples
+    Uns64 max;                          // largest sample
+    Uns64 buckets[RISCV_TP_BUCKETS];    // log2 buckets
+} riscvTrapHist, *riscvTrapHistP;
+
+//
+// This holds trap profile state for a hart
+//
+typedef struct riscvTrapProfileS {
+    Uns32          intNum;                          // number of interrupts
+    Uns32          depth;                           // current nesting depth
+    Uns32          maxDepth;                        // maximum nesting depth
+    Uns64         *exceptCounts;                    // per mode/exception count
+    Uns64         *intCounts;                       // per mode/interrupt count
+    Uns64         *raised;                          // cycle of input assertion
+    riscvTrapHist  handlerCost;                     // instructions in handler
+    riscvTrapHist  intLatency;                      // cycles to handler entry
+    riscvTrapFrame frames[RISCV_TP_MAX_NEST];       // active traps
+} riscvTrapProfile;
+
+//
+// Return the hart name used in profile reports
+//
+inline static const char *getName(riscvP riscv) {
+    return vmirtProcessorName((vmiProcessorP)riscv);
+}
+
+//
+// Return log2 histogram bucket for the value
+//
+static Uns32 getBucket(Uns64 value) {
+
+    Uns32 result = 0;
+
+    while(value) {
+        value >>= 1;
+        result++;
+    }
+
+    return result;
+}
+
+//
+// Add a sample to a histogram
+//
+static void addSample(riscvTrapHistP hist, Uns64 value) {
+
+    hist->num++;
+    hist->total += value;
+    hist->buckets[getBucket(value)]++;
+
+    if(hist->max<value) {
+        hist->max = value;
+    }
+}
+
+//
+// Allocate trap profile data structures if required
+//
+void riscvNewTrapProfile(riscvP riscv) {
+
+    if(riscv->configInfo.trap_profile) {
+
+        riscvTrapProfileP profile = STYPE_CALLOC(riscvTrapProfile);
+        Uns32             intNum  = riscvGetIntNum(riscv);
+        Uns32             numE    = RISCV_MODE_LAST*RISCV_TP_EXCEPT_NUM;
+        Uns32             numI    = RISCV_MODE_LAST*intNum;
+        Uns32             i;
+
+        profile->intNum       = intNum;
+        profile->exceptCounts = STYPE_CALLOC_N(Uns64, numE);
+        profile->intCounts    = STYPE_CALLOC_N(Uns64, numI);
+        profile->raised       = STYPE_CALLOC_N(Uns64, intNum);
+
+        for(i=0; i<intNum; i++) {
+            profile->raised[i] = RISCV_TP_NOT_RAISED;
+        }
+
+        riscv->trapProfile = profile;
+    }
+}
+
+//
+// Report histogram
+//
+static void reportHist(riscvP riscv, const char *name, riscvTrapHistP hist) {
+
+    Uns32 i;
+
+    if(hist->num) {
+
+        vmiMessage("I", CPU_PREFIX "_TPH",
+            "%s: %s samples="FMT_64u" mean="FMT_64u" max="FMT_64u,
+            getName(riscv), name,
+            hist->num, hist->total/hist->num, hist->max
+        );
+
+        for(i=0; i<RISCV_TP_BUCKETS; i++) {
+
+            if(hist->buckets[i]) {
+
+                Uns64 low  = i ? 1ULL<<(i-1) : 0;
+                Uns64 high = i ? (low<<1)-1  : 0;
+
+                vmiMessage("I", CPU_PREFIX "_TPB",
+                    "%s: %s ["FMT_64u","FMT_64u"] "FMT_64u,
+                    getName(riscv), name, low, high, hist->buckets[i]
+                );
+            }
+        }
+    }
+}
+
+//
+// Report trap profile
+//
+static void reportTrapProfile(riscvP riscv, riscvTrapProfileP profile) {
+
+    riscvMode mode;
+    Uns32     i;
+
+    for(mode=0; mode<RISCV_MODE_LAST; mode++) {
+
+        Uns64 *exceptCounts = &profile->exceptCounts[mode*RISCV_TP_EXCEPT_NUM];
+        Uns64 *intCounts    = &profile->intCounts[mode*profile->intNum];
+
+        for(i=0; i<RISCV_TP_EXCEPT_NUM; i++) {
+            if(exceptCounts[i]) {
+                vmiMessage("I", CPU_PREFIX "_TPE",
+                    "%s: %s-mode exception %u count="FMT_64u,
+                    getName(riscv), riscvGetModeName(mode), i, exceptCounts[i]
+                );
+            }
+        }
+
+        for(i=0; i<profile->intNum; i++) {
+            if(intCounts[i]) {
+                vmiMessage("I", CPU_PREFIX "_TPI",
+                    "%s: %s-mode interrupt %u count="FMT_64u,
+                    getName(riscv), riscvGetModeName(mode), i, intCounts[i]
+                );
+            }
+        }
+    }
+
+    vmiMessage("I", CPU_PREFIX "_TPN",
+        "%s: maximum trap nesting depth %u",
+        getName(riscv), profile->maxDepth
+    );
+
+    reportHist(riscv, "handler instructions", &profile->handlerCost);
+    reportHist(riscv, "interrupt latency cycles", &profile->intLatency);
+}
+
+//
+// Report and free trap profile data structures
+//
+void riscvFreeTrapProfile(riscvP riscv) {
+
+    riscvTrapProfileP profile = riscv->trapProfile;
+
+    if(profile) {
+
+        reportTrapProfile(riscv, profile);
+
+        STYPE_FREE(profile->exceptCounts);
+        STYPE_FREE(profile->intCounts);
+        STYPE_FREE(profile->raised);
+        STYPE_FREE(profile);
+
+        riscv->trapProfile = 0;
+    }
+}
+
+//
+// Reset trap profile nesting state
+//
+void riscvResetTrapProfile(riscvP riscv) {
+
+    riscvTrapProfileP profile = riscv->trapProfile;
+
+    if(profile) {
+        profile->depth = 0;
+    }
+}
+
+//
+// Record change of the indexed interrupt input
+//
+void riscvProfileInterruptInput(riscvP riscv, Uns32 index, Bool newValue) {
+
+    riscvTrapProfileP profile = riscv->trapProfile;
+
+    if(profile && (index<profile->intNum)) {
+
+        Uns64 *raised = &profile->raised[index];
+
+        if(!newValue) {
+            *raised = RISCV_TP_NOT_RAISED;
+        } else if(*raised==RISCV_TP_NOT_RAISED) {
+            *raised = vmirtGetICount((vmiProcessorP)riscv);
+        }
+    }
+}
+
+//
+// Record entry to a trap handler in the given mode
+//
+void riscvProfileTrapEntry(
+    riscvP         riscv,
+    riscvException exception,
+    riscvMode      modeX
+) {
+    riscvTrapProfileP profile = riscv->trapProfile;
+
+    if(profile) {
+
+        vmiProcessorP processor = (vmiProcessorP)riscv;
+        Uns32         code      = getExceptionCode(exception);
+
+        // count trap by cause and target mode
+        if(!isInterrupt(exception)) {
+
+            if(code<RISCV_TP_EXCEPT_NUM) {
+                profile->exceptCounts[modeX*RISCV_TP_EXCEPT_NUM+code]++;
+            }
+
+        } else if(code<profile->intNum) {
+
+            Uns64 raised = profile->raised[code];
+
+            profile->intCounts[modeX*profile->intNum+code]++;
+
+            // record latency from input assertion to handler entry
+            if(raised!=RISCV_TP_NOT_RAISED) {
+                addSample(
+                    &profile->intLatency, vmirtGetICount(processor)-raised
+                );
+                profile->raised[code] = RISCV_TP_NOT_RAISED;
+            }
+        }
+
+        // record entry to nested handler
+        if(profile->depth<RISCV_TP_MAX_NEST) {
+            riscvTrapFrameP frame = &profile->frames[profile->depth];
+            frame->entryCount = vmirtGetExecutedICount(processor);
+            frame->exception  = exception;
+        }
+
+        // track maximum nesting depth
+        if(profile->maxDepth < ++profile->depth) {
+            profile->maxDepth = profile->depth;
+        }
+    }
+}
+
+//
+// Record return from a trap handler
+//
+void riscvProfileTrapReturn(riscvP riscv) {
+
+    riscvTrapProfileP profile = riscv->trapProfile;
+
+    if(profile && profile->depth) {
+
+        // record instructions executed by the handler
+        if(--profile->depth<RISCV_TP_MAX_NEST) {
+
+            vmiProcessorP   processor = (vmiProcessorP)riscv;
+            riscvTrapFrameP frame     = &profile->frames[profile->depth];
+            Uns64           now       = vmirtGetExecutedICount(processor);
+
+            addSample(&profile->handlerCost, now-frame->entryCount);
+        }
+    }
+}
+
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// basic types
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvExceptionTypes.h"
+#include "riscvMode.h"
+#include "riscvTypeRefs.h"
+
+
+//
+// Allocate trap profile data structures if required
+//
+void riscvNewTrapProfile(riscvP riscv);
+
+//
+// Report and free trap profile data structures
+//
+void riscvFreeTrapProfile(riscvP riscv);
+
+//
+// Reset trap profile nesting state
+//
+void riscvResetTrapProfile(riscvP riscv);
+
+//
+// Record change of the indexed interrupt input
+//
+void riscvProfileInterruptInput(riscvP riscv, Uns32 index, Bool newValue);
+
+//
+// Record entry to a trap handler in the given mode
+//
+void riscvProfileTrapEntry(
+    riscvP         riscv,
+    riscvException exception,
+    riscvMode      modeX
+);
+
+//
+// Record return from a trap handler
+//
+void riscvProfileTrapReturn(riscvP riscv);
+
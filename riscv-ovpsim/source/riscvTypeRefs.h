@@ -23,15 +23,18 @@
 #include "hostapi/typeMacros.h"
 
 DEFINE_S (riscv);
+DEFINE_S (riscvBatch);
 DEFINE_S (riscvBlockState);
 DEFINE_S (riscvBusPort);
 DEFINE_U (riscvCLICIntState);
 DEFINE_S (riscvCLICOutState);
 DEFINE_S (riscvCSRRemap);
+DEFINE_S (riscvCommitRing);
 DEFINE_S (riscvConfig);
 DEFINE_CS(riscvConfig);
 DEFINE_S (riscvCSRAttrs);
 DEFINE_CS(riscvCSRAttrs);
+DEFINE_S (riscvDeltaCP);
 DEFINE_S (riscvExceptionDesc);
 DEFINE_CS(riscvExceptionDesc);
 DEFINE_S (riscvExtCB);
@@ -41,10 +44,21 @@ DEFINE_S (riscvExtInstrInfo);
 DEFINE_CS(riscvExtMorphAttr);
 DEFINE_S (riscvExtMorphState);
 DEFINE_S (riscvInstrInfo);
+DEFINE_S (riscvIntSelect);
 DEFINE_S (riscvNetPort);
 DEFINE_CS(riscvMorphAttr);
 DEFINE_S (riscvMorphState);
+DEFINE_S (riscvPageTracker);
 DEFINE_S (riscvParamValues);
 DEFINE_S (riscvPendEnab);
+DEFINE_S (riscvRunProfile);
+DEFINE_S (riscvSemihost);
+DEFINE_S (riscvSignature);
+DEFINE_S (riscvSnapEntry);
+DEFINE_CS(riscvSnapEntry);
+DEFINE_S (riscvSnapLayout);
+DEFINE_CS(riscvSnapLayout);
 DEFINE_S (riscvTLB);
+DEFINE_S (riscvTrapProfile);
+DEFINE_S (riscvVTypeInfo);
 
@@ -25,6 +25,7 @@
 
 // model header files
 #include "riscvBlockState.h"
+#include "riscvCommitRing.h"
 #include "riscvDecode.h"
 #include "riscvExceptions.h"
 #include "riscvFunctions.h"
@@ -383,6 +384,7 @@ void riscvSetMode(riscvP riscv, riscvMode mode) {
     if(riscv->mode != dMode) {
         riscv->mode = dMode;
         vmirtSetMode((vmiProcessorP)riscv, dMode);
+        riscvMarkInterruptStale(riscv, -1);
     }
 
     // refresh current data domain (may be modified by mstatus.MPRV, and may
@@ -786,6 +788,7 @@ RISCV_SET_TMODE_FN(riscvSetTMode) {
         riscv->useTMode = True;
 
         vmirtFlushAllDicts((vmiProcessorP)riscv);
+        riscvCommitRingCodeFlush(riscv);
     }
 
     // enable mode using polymorphic key
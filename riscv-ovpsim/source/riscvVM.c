@@ -31,7 +31,10 @@
 #include "vmi/vmiTypes.h"
 
 // Model header files
+#include "riscvBatch.h"
 #include "riscvCLIC.h"
+#include "riscvCLINT.h"
+#include "riscvCheckpoint.h"
 #include "riscvExceptions.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
@@ -114,8 +117,11 @@ typedef struct tlbEntryS {
 // Structure representing a TLB
 //
 typedef struct riscvTLBS {
-    vmiRangeTableP lut;     // range LUT entry (for fast lookup by address)
-    tlbEntryP      free;    // list of free TLB entries available for reuse
+    vmiRangeTableP lut;         // range LUT entry (for fast lookup by address)
+    tlbEntryP      free;        // list of free TLB entries available for reuse
+    tlbEntryP      pending;     // restored entries not yet inserted (lazy)
+    vmiRangeTableP pendingLUT;  // range LUT of entries not yet inserted
+    Uns32          numPending;  // number of restored entries not yet inserted
 } riscvTLB;
 
 //
@@ -1826,6 +1832,68 @@ inline static void insertTLBEntry(riscvTLBP tlb, tlbEntryP entry) {
     );
 }
 
+//
+// Discard restored TLB entries that have not yet been inserted
+//
+static void discardPendingTLBEntries(riscvTLBP tlb) {
+
+    if(tlb->pending) {
+        vmirtFreeRangeTable(&tlb->pendingLUT);
+        STYPE_FREE(tlb->pending);
+        tlb->pending    = 0;
+        tlb->numPending = 0;
+    }
+}
+
+//
+// Return the restored TLB entry for a pending range LUT entry
+//
+static tlbEntryP getPendingTLBEntry(vmiRangeEntryP lutEntry) {
+
+    union {Uns64 u64; tlbEntryP entry;} u = {
+        lutEntry ? vmirtGetRangeEntryUserData(lutEntry) : 0
+    };
+
+    return u.entry;
+}
+
+//
+// Insert the restored TLB entry, removing it from the pending range LUT
+//
+static tlbEntryP insertPendingTLBEntry(riscvTLBP tlb, tlbEntryP pending) {
+
+    tlbEntryP entry = newTLBEntry(tlb);
+
+    // remove the entry from the pending range LUT
+    vmirtRemoveRangeEntry(&tlb->pendingLUT, pending->lutEntry);
+
+    // copy entry contents and insert it into the processor TLB table
+    *entry = *pending;
+    insertTLBEntry(tlb, entry);
+
+    // release the pending list when it is empty
+    if(!--tlb->numPending) {
+        discardPendingTLBEntries(tlb);
+    }
+
+    return entry;
+}
+
+//
+// Insert all restored TLB entries that have not yet been inserted
+//
+static void insertAllPendingTLBEntries(riscvTLBP tlb) {
+
+    while(tlb->numPending) {
+
+        vmiRangeEntryP lutEntry = vmirtGetFirstRangeEntry(
+            &tlb->pendingLUT, 0, RISCV_MAX_ADDR
+        );
+
+        insertPendingTLBEntry(tlb, getPendingTLBEntry(lutEntry));
+    }
+}
+
 //
 // Allocate a new TLB entry, filling it from the base object
 //
@@ -1933,10 +2001,15 @@ static void invalidateTLBEntriesRange(
     riscvTLBP tlb = riscv->tlb[id];
 
     if(tlb) {
+
         ITER_TLB_ENTRY_RANGE(
             riscv, tlb, lowVA, highVA, entry,
             deleteTLBEntryMode(riscv, tlb, entry, mode, ASID)
         );
+
+        // restored entries not yet inserted are discarded (this is always
+        // legal because the TLB is a cache)
+        discardPendingTLBEntries(tlb);
     }
 }
 
@@ -1990,6 +2063,9 @@ static void dumpTLB(riscvP riscv, riscvTLBP tlb) {
 
         vmiPrintf("TLB CONTENTS:\n");
 
+        // include restored entries not yet inserted
+        insertAllPendingTLBEntries(tlb);
+
         ITER_TLB_ENTRY_RANGE(
             riscv, tlb, 0, RISCV_MAX_ADDR, entry,
             dumpTLBEntry(riscv, entry)
@@ -2169,6 +2245,37 @@ static memDomainP createCLICDomain(riscvP riscv, memDomainP dataDomain) {
     return root->CLICDomain;
 }
 
+//
+// Create new CLINT domain at cluster root level
+//
+static memDomainP createCLINTDomain(riscvP riscv, memDomainP dataDomain) {
+
+    riscvP root = riscv->smpRoot;
+
+    // CLINT memory map is shared by all harts in a cluster
+    if(!root->CLINTDomain) {
+
+        Uns32 bits = vmirtGetDomainAddressBits(dataDomain);
+        Uns64 mask = getAddressMask(bits);
+
+        // create domain of width bits
+        memDomainP CLINTDomain = createDomain(
+            RISCV_MODE_M, "CLINT", bits, False, False
+        );
+
+        // create mapping to data domain
+        vmirtAliasMemory(dataDomain, CLINTDomain, 0, mask, 0, 0);
+
+        // create CLINT memory-mapped block
+        riscvMapCLINTDomain(root, CLINTDomain);
+
+        // save CLINT domain on cluster root
+        root->CLINTDomain = CLINTDomain;
+    }
+
+    return root->CLINTDomain;
+}
+
 //
 // Do transaction load
 //
@@ -2282,6 +2389,7 @@ VMI_VMINIT_FN(riscvVMInit) {
     riscvP     riscv      = (riscvP)processor;
     memDomainP codeDomain = codeDomains[0];
     memDomainP dataDomain = dataDomains[0];
+    memDomainP extDomain  = dataDomain;
     Uns32      codeBits   = vmirtGetDomainAddressBits(codeDomain);
     Uns32      dataBits   = vmirtGetDomainAddressBits(dataDomain);
     riscvMode  mode;
@@ -2293,11 +2401,19 @@ VMI_VMINIT_FN(riscvVMInit) {
     // save size of physical domain
     riscv->extBits = (codeBits<dataBits) ? codeBits : dataBits;
 
+    // track pages written in physical memory for delta checkpoints if required
+    riscvNewDeltaCheckpoint(riscv, dataDomain);
+
     // install memory-mapped CLIC control register block if required
     if(CLICInternal(riscv)) {
         dataDomain = createCLICDomain(riscv, dataDomain);
     }
 
+    // install memory-mapped CLINT register block if required
+    if(CLINTInternal(riscv)) {
+        dataDomain = createCLINTDomain(riscv, dataDomain);
+    }
+
     // create per-base-mode domains
     for(mode=RISCV_MODE_S; mode<RISCV_MODE_LAST_BASE; mode++) {
 
@@ -2384,6 +2500,9 @@ VMI_VMINIT_FN(riscvVMInit) {
         createTLB(riscv, RISCV_TLB_VS1);
         createTLB(riscv, RISCV_TLB_VS2);
     }
+
+    // load the first batch mode test if required
+    riscvStartBatch(riscv, extDomain);
 }
 
 //
@@ -2403,6 +2522,25 @@ static tlbEntryP findTLBEntry(riscvP riscv, riscvTLBP tlb, Uns64 VA) {
         }
     );
 
+    // insert any matching restored entry not yet inserted
+    if(tlb->numPending) {
+
+        vmiRangeEntryP lutEntry = vmirtGetFirstRangeEntry(
+            &tlb->pendingLUT, VA, VA
+        );
+
+        while(lutEntry) {
+
+            tlbEntryP entry = getPendingTLBEntry(lutEntry);
+
+            if(matchVMID(VMID, entry) && matchASID(ASID, entry)) {
+                return insertPendingTLBEntry(tlb, entry);
+            }
+
+            lutEntry = vmirtGetNextRangeEntry(&tlb->pendingLUT, VA, VA);
+        }
+    }
+
     // here if there is no match
     return 0;
 }
@@ -3535,6 +3673,69 @@ Bool riscvVMMiss(
     return miss;
 }
 
+//
+// Return a Boolean indicating whether every byte in the passed range has the
+// specified access privilege in the domain (privileges are uniform within a
+// PMP grain, so one byte of each grain is checked)
+//
+static Bool rangeHasPriv(
+    riscvP     riscv,
+    memDomainP domain,
+    memPriv    requiredPriv,
+    Uns64      address,
+    Uns32      bytes
+) {
+    Uns64 grain = 4ULL << riscv->configInfo.PMP_grain;
+    Uns64 last  = address+bytes-1;
+    Uns64 check = address;
+    Bool  ok;
+
+    do {
+        ok    = (
+            (vmirtGetDomainPrivileges(domain, check) & requiredPriv) ==
+            requiredPriv
+        );
+        check = (check & -grain) + grain;
+    } while(ok && check && (check<=last));
+
+    return ok;
+}
+
+//
+// Try mapping memory in the passed range for the specified access type
+// without taking any exception, returning a Boolean indicating whether an
+// access of that type to every byte in the range would now succeed without a
+// further miss
+//
+Bool riscvVMProbe(
+    riscvP     riscv,
+    memDomainP domain,
+    memPriv    requiredPriv,
+    Uns64      address,
+    Uns32      bytes
+) {
+    Bool ok = rangeHasPriv(riscv, domain, requiredPriv, address, bytes);
+
+    if(!ok) {
+
+        // enter probe context
+        riscv->VMProbe     = True;
+        riscv->VMProbeFail = False;
+
+        riscvVMMiss(riscv, domain, requiredPriv, address, bytes, MEM_AA_TRUE);
+
+        // exit probe context
+        riscv->VMProbe = False;
+
+        ok = (
+            !riscv->VMProbeFail &&
+            rangeHasPriv(riscv, domain, requiredPriv, address, bytes)
+        );
+    }
+
+    return ok;
+}
+
 //
 // Free structures used for virtual memory management
 //
@@ -3715,71 +3916,189 @@ void riscvVMRefreshMPRVDomain(riscvP riscv) {
 // TLB SAVE/RESTORE SUPPORT
 ////////////////////////////////////////////////////////////////////////////////
 
-#define RISCV_TLB_ENTRY "TLB_ENTRY"
-#define RISCV_TLB_END   "TLB_END"
-
 //
-// Save contents of one TLB entry
+// Compact representation of a TLB entry in saved state
 //
-static void saveTLBEntry(vmiSaveContextP cxt, tlbEntryP entry) {
+typedef struct tlbSavedEntryS {
+    Uns64 lowVA;        // entry low virtual address
+    Uns64 highVA;       // entry high virtual address
+    Uns64 PA;           // entry low physical address
+    Uns64 simASID;      // simulated ASID when mapped
+    Uns32 tlb  :  2;    // containing TLB
+    Uns32 priv :  3;    // access privilege
+    Uns32 U    :  1;    // user accessible?
+    Uns32 G    :  1;    // global bit
+    Uns32 A    :  1;    // accessed bit (read or written)
+    Uns32 D    :  1;    // dirty bit (written)
+    Uns32 _u1  : 23;    // spare bits
+} tlbSavedEntry, *tlbSavedEntryP;
 
-    // save entry
-    tlbEntry entryS = *entry;
+//
+// Fill save/restore key for the given TLB and field
+//
+static void getTLBKey(char *key, riscvTLBId id, const char *field) {
+    sprintf(key, "TLB%u.%s", id, field);
+}
 
-    // clear down properties used to manage mapping
-    entryS.mapped   = 0;
-    entryS.lutEntry = 0;
+//
+// Pack one TLB entry for saving
+//
+static void packTLBEntry(tlbSavedEntryP saved, tlbEntryP entry) {
 
-    vmirtSaveElement(
-        cxt, RISCV_TLB_ENTRY, RISCV_TLB_END, &entryS, sizeof(entryS)
-    );
+    *saved = (tlbSavedEntry){
+        lowVA   : entry->lowVA,
+        highVA  : entry->highVA,
+        PA      : entry->PA,
+        simASID : entry->simASID.u64,
+        tlb     : entry->tlb,
+        priv    : entry->priv,
+        U       : entry->U,
+        G       : entry->G,
+        A       : entry->A,
+        D       : entry->D,
+    };
 }
 
 //
-// Restore contents of one TLB entry
+// Unpack one saved TLB entry (the entry is not mapped)
 //
-static void restoreTLBEntry(riscvTLBP tlb, tlbEntryP new) {
+static void unpackTLBEntry(tlbEntryP entry, tlbSavedEntryP saved) {
 
-    tlbEntryP entry = newTLBEntry(tlb);
-
-    // copy entry contents
-    *entry = *new;
+    *entry = (tlbEntry){
+        lowVA   : saved->lowVA,
+        highVA  : saved->highVA,
+        PA      : saved->PA,
+        tlb     : saved->tlb,
+        priv    : saved->priv,
+        U       : saved->U,
+        G       : saved->G,
+        A       : saved->A,
+        D       : saved->D,
+    };
 
-    // insert it into the processor TLB table
-    insertTLBEntry(tlb, entry);
+    entry->simASID.u64 = saved->simASID;
 }
 
 //
-// Save contents of the TLB
+// Save contents of the TLB as a single packed array
 //
-static void saveTLB(riscvP riscv, riscvTLBP tlb, vmiSaveContextP cxt) {
+static void saveTLB(
+    riscvP          riscv,
+    riscvTLBP       tlb,
+    riscvTLBId      id,
+    vmiSaveContextP cxt
+) {
+    Uns32          num   = tlb->numPending;
+    Uns32          index = 0;
+    tlbSavedEntryP saved;
+    char           key[32];
+
+    // count all non-artifact TLB entries
+    ITER_TLB_ENTRY_RANGE(
+        riscv, tlb, 0, RISCV_MAX_ADDR, entry,
+        if(!entry->artifact) {
+            num++;
+        }
+    );
+
+    // pack all non-artifact TLB entries, including restored entries not yet
+    // inserted
+    saved = STYPE_CALLOC_N(tlbSavedEntry, num ? : 1);
 
-    // save all non-artifact TLB entries
     ITER_TLB_ENTRY_RANGE(
         riscv, tlb, 0, RISCV_MAX_ADDR, entry,
         if(!entry->artifact) {
-            saveTLBEntry(cxt, entry);
+            packTLBEntry(&saved[index++], entry);
         }
     );
 
-    // save terminator
-    vmirtSaveElement(cxt, RISCV_TLB_ENTRY, RISCV_TLB_END, 0, 0);
+    if(tlb->numPending) {
+
+        vmiRangeEntryP lutEntry = vmirtGetFirstRangeEntry(
+            &tlb->pendingLUT, 0, RISCV_MAX_ADDR
+        );
+
+        while(lutEntry) {
+
+            packTLBEntry(&saved[index++], getPendingTLBEntry(lutEntry));
+
+            lutEntry = vmirtGetNextRangeEntry(
+                &tlb->pendingLUT, 0, RISCV_MAX_ADDR
+            );
+        }
+    }
+
+    // save entry count and packed entries
+    getTLBKey(key, id, "count");
+    vmirtSave(cxt, key, &num, sizeof(num));
+
+    if(num) {
+        getTLBKey(key, id, "entries");
+        vmirtSave(cxt, key, saved, num*sizeof(*saved));
+    }
+
+    STYPE_FREE(saved);
 }
 
 //
-// Restore contents of the TLB
+// Restore contents of the TLB, either inserting entries immediately or
+// deferring insertion of each entry until it is first looked up
 //
-static void restoreTLB(riscvP riscv, riscvTLBP tlb, vmiRestoreContextP cxt) {
+static void restoreTLB(
+    riscvP             riscv,
+    riscvTLBP          tlb,
+    riscvTLBId         id,
+    vmiRestoreContextP cxt,
+    Bool               lazy
+) {
+    Uns32 num = 0;
+    char  key[32];
+    Uns32 i;
 
-    tlbEntry new;
+    // restore entry count
+    getTLBKey(key, id, "count");
+    vmirtRestore(cxt, key, &num, sizeof(num));
 
-    // restore all TLB entries
-    while(
-        vmirtRestoreElement(
-            cxt, RISCV_TLB_ENTRY, RISCV_TLB_END, &new, sizeof(new)
-        ) == SRS_OK
-    ) {
-        restoreTLBEntry(tlb, &new);
+    if(num) {
+
+        tlbSavedEntryP saved = STYPE_CALLOC_N(tlbSavedEntry, num);
+
+        // restore packed entries
+        getTLBKey(key, id, "entries");
+        vmirtRestore(cxt, key, saved, num*sizeof(*saved));
+
+        if(lazy) {
+
+            // defer insertion until each entry is first looked up, indexing
+            // deferred entries by address so that lookups need not scan them
+            tlb->pending    = STYPE_CALLOC_N(tlbEntry, num);
+            tlb->numPending = num;
+            vmirtNewRangeTable(&tlb->pendingLUT);
+
+            for(i=0; i<num; i++) {
+
+                tlbEntryP entry = &tlb->pending[i];
+
+                unpackTLBEntry(entry, &saved[i]);
+
+                entry->lutEntry = vmirtInsertRangeEntry(
+                    &tlb->pendingLUT, entry->lowVA, entry->highVA, (UnsPS)entry
+                );
+            }
+
+        } else {
+
+            // insert all entries into the processor TLB table
+            for(i=0; i<num; i++) {
+
+                tlbEntryP entry = newTLBEntry(tlb);
+
+                unpackTLBEntry(entry, &saved[i]);
+                insertTLBEntry(tlb, entry);
+            }
+        }
+
+        STYPE_FREE(saved);
     }
 }
 
@@ -3790,12 +4109,17 @@ static void saveVM(riscvP riscv, vmiSaveContextP cxt) {
 
     riscvTLBId id;
 
+    // TLB contents are not saved if required (the TLB is a cache)
+    if(riscv->configInfo.TLB_save==RVTS_NONE) {
+        return;
+    }
+
     for(id=0; id<RISCV_TLB_LAST; id++) {
 
         riscvTLBP tlb = riscv->tlb[id];
 
         if(tlb) {
-            saveTLB(riscv, tlb, cxt);
+            saveTLB(riscv, tlb, id, cxt);
         }
     }
 }
@@ -3805,15 +4129,20 @@ static void saveVM(riscvP riscv, vmiSaveContextP cxt) {
 //
 static void restoreVM(riscvP riscv, vmiRestoreContextP cxt) {
 
-    riscvTLBId id;
+    riscvTLBSaveMode mode = riscv->configInfo.TLB_save;
+    riscvTLBId       id;
 
     for(id=0; id<RISCV_TLB_LAST; id++) {
 
         riscvTLBP tlb = riscv->tlb[id];
 
         if(tlb) {
+
             invalidateTLBEntriesRange(riscv, id, 0, RISCV_MAX_ADDR, MM_ANY, 0);
-            restoreTLB(riscv, tlb, cxt);
+
+            if(mode!=RVTS_NONE) {
+                restoreTLB(riscv, tlb, id, cxt, mode==RVTS_LAZY);
+            }
         }
     }
 }
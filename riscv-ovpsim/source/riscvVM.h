@@ -38,6 +38,20 @@ Bool riscvVMMiss(
     memAccessAttrs attrs
 );
 
+//
+// Try mapping memory in the passed range for the specified access type
+// without taking any exception, returning a Boolean indicating whether an
+// access of that type to every byte in the range would now succeed without a
+// further miss
+//
+Bool riscvVMProbe(
+    riscvP     riscv,
+    memDomainP domain,
+    memPriv    requiredPriv,
+    Uns64      address,
+    Uns32      bytes
+);
+
 //
 // Free structures used for virtual memory management
 //
@@ -243,6 +243,15 @@ typedef enum riscvFSModeE {
     RVFS_ALWAYS_DIRTY,                  // mstatus.FS is always off or dirty
 } riscvFSMode;
 
+//
+// Supported TLB save/restore behavior
+//
+typedef enum riscvTLBSaveModeE {
+    RVTS_EAGER,                         // TLB entries inserted on restore
+    RVTS_LAZY,                          // TLB entries inserted on first use
+    RVTS_NONE,                          // TLB contents not saved
+} riscvTLBSaveMode;
+
 //
 // Supported interrupt configuration
 //
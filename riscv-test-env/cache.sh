@@ -0,0 +1,138 @@
+#!/bin/bash
+
+#
+# Result cache for compliance runs.
+#
+#   cache.sh fetch <elf> <stem>     restore <stem>.* outputs, fail on a miss
+#   cache.sh store <elf> <stem>     save <stem>.* outputs after a run
+#
+# Entries live in ${RESULT_CACHE} (empty to disable) and are keyed by the
+# SHA-256 of the ELF, the simulator executable ${TARGET_SIM} and every file
+# beside it or listed by ldd (shared libraries and models it loads), the target
+# device Makefile.include ${TARGET_INCLUDE}, the expanded run command with its
+# variant and overrides (${RUN_TARGET_HASH}), ${TARGET_FLAGS}, ${COVERTYPE},
+# the target, device and ISA names and whether tests run in persistent
+# simulators (${OVPSIM_SERVER}, with its ${OVPSIM_SERVER_LIMIT}). Every output
+# file of a test (log, signature, coverage) except its run profile is stored,
+# so a hit is indistinguishable from a run.
+#
+
+OP=$1
+ELF=$2
+STEM=$3
+
+if [ -z "${RESULT_CACHE}" ] || [ ! -f "${ELF}" ]; then
+    [ "${OP}" == "store" ]
+    exit
+fi
+
+#
+# Size and modification time of a file, using GNU stat, BSD stat or ls
+#
+filestamp() {
+    stat -L -c '%s %Y' "$1" 2> /dev/null ||
+        stat -L -f '%z %m' "$1" 2> /dev/null ||
+        ls -lLn "$1"
+}
+
+#
+# Hash of a file, memoised on path, size and modification time so that
+# large simulator executables are only read once
+#
+filehash() {
+    local file=$1
+    local stamp memo
+
+    if [ ! -f "${file}" ]; then
+        file=$(command -v "${file}" 2> /dev/null)
+    fi
+
+    if [ -z "${file}" ] || [ ! -f "${file}" ]; then
+        echo "none"
+        return
+    fi
+
+    stamp=$(filestamp "${file}")
+    memo=$(echo "${file} ${stamp}" | sha256sum | cut -c1-64)
+    memo=${RESULT_CACHE}/files/${memo}
+
+    if [ ! -f ${memo} ]; then
+        mkdir -p $(dirname ${memo})
+        sha256sum < "${file}" | cut -c1-64 > ${memo}.$$ && mv ${memo}.$$ ${memo}
+    fi
+    cat ${memo}
+}
+
+#
+# Hashes of the simulator, the files installed beside it and the shared
+# libraries it loads
+#
+simhash() {
+    local sim dir dep
+
+    sim=$(command -v "${TARGET_SIM}" 2> /dev/null)
+
+    if [ -z "${sim}" ]; then
+        echo "none"
+        return
+    fi
+
+    # files installed beside the simulator, unless it lives in a shared
+    # system directory
+    case $(dirname "${sim}") in
+        /bin|/sbin|/usr/bin|/usr/sbin|/usr/local/bin) dir= ;;
+        *) dir=$(dirname "${sim}") ;;
+    esac
+
+    for dep in ${dir:+${dir}/*} \
+        $(ldd "${sim}" 2> /dev/null | awk '$3 ~ /^\// {print $3}')
+    do
+        [ -f "${dep}" ] && echo "${dep##*/} $(filehash "${dep}")"
+    done
+}
+
+KEY=$({
+    sha256sum < "${ELF}" | cut -c1-64
+    filehash "${TARGET_SIM}"
+    simhash
+    filehash "${TARGET_INCLUDE}"
+    echo "${RISCV_TARGET}|${RISCV_DEVICE}|${RISCV_ISA}|${COVERTYPE}"
+    echo "${TARGET_FLAGS}"
+    echo "${RUN_TARGET_HASH}"
+    echo "mode=${OVPSIM_SERVER:+server ${OVPSIM_SERVER_LIMIT}}"
+} | sha256sum | cut -c1-64)
+
+ENTRY=${RESULT_CACHE}/results/${KEY:0:2}/${KEY}
+
+case ${OP} in
+    fetch)
+        [ -d ${ENTRY} ] || exit 1
+        for f in ${ENTRY}/*; do
+            cp "${f}" "${STEM}.$(basename ${f})" || exit 1
+        done
+        touch ${STEM}.log
+        ;;
+    store)
+        # only complete runs are cached
+        [ -f ${STEM}.signature.output ] || exit 0
+        [ -d ${ENTRY} ] && exit 0
+        TMP=${ENTRY}.$$
+        mkdir -p ${TMP}
+        for f in ${STEM}.*; do
+            case ${f} in
+                ${STEM}.elf*|${STEM}.profile.json) ;;
+                *) cp "${f}" "${TMP}/${f#${STEM}.}" ;;
+            esac
+        done
+        # publish atomically; if another job stored the same key first, the
+        # copy is moved inside its entry and removed
+        mv ${TMP} ${ENTRY} 2> /dev/null
+        rm -rf ${TMP} ${ENTRY}/$(basename ${TMP})
+        ;;
+    *)
+        echo "usage: $0 fetch|store <elf> <stem>" >&2
+        exit 2
+        ;;
+esac
+
+exit 0
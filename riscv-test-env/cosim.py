@@ -0,0 +1,544 @@
+#!/usr/bin/env python3
+
+# Copyright Imperas Software Ltd
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''
+    Lockstep co-simulation of riscvOVPsim against a reference model
+
+    Each ELF is run on riscvOVPsim with parameter commit_ring set, and on the
+    reference model at the same time. Every retired instruction of each model
+    (PC, encoding, destination X register value and CSR write) is compared as
+    it arrives, and the run stops at the first divergence, which is reported
+    with the preceding instructions of both models.
+
+    riscvOVPsim writes 32-byte records to a ring in a shared memory file and
+    publishes them in batches; it waits when the ring is full, so it runs at
+    most one ring ahead of the comparison. The header (64 bytes) holds, in
+    order: the magic number, the capacity and record size, the published
+    head and consumed tail indices (64-bit), and the stop and done flags
+    (32-bit). Each record holds the PC, X register value, CSR value (64-bit),
+    encoding (32-bit), register number, flags (8-bit) and CSR number (16-bit).
+    All fields are little endian.
+
+    Only the CSR named by a CSR instruction is recorded. Implicit CSR updates
+    (mstatus, mepc, mcause and mtval written on trap entry, mstatus written
+    by xRET, fflags accumulated by floating point instructions and counters)
+    are not recorded by riscvOVPsim and so are not compared; a divergence in
+    one of these is reported only when it later changes a PC, register value
+    or CSR instruction result. Instructions that trap do not retire and have
+    no record.
+
+    The reference model is by default spike, whose commit log (-l
+    --log-commits) is read from its standard error; with --ref-ring it is any
+    model writing the same ring format to {refring}. Reference instructions
+    before the first PC of riscvOVPsim (boot code) are skipped, and the
+    reference is not required to stop when riscvOVPsim does.
+
+    Command templates may use {sim}, {variant}, {isa}, {elf}, {ring},
+    {refring} and {out} (a temporary path prefix for other output files).
+'''
+
+import argparse
+import collections
+import mmap
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+RING_MAGIC = 0x31474e4952435652
+RING_HEADER = struct.Struct('<QIIQQII24x')
+RING_RECORD = struct.Struct('<QQQIBBH')
+RING_HEAD = 16
+RING_TAIL = 24
+RING_STOP = 32
+RING_DONE = 36
+RING_POLL = 0.0002
+
+HAS_RD = 0x1
+HAS_CSR = 0x2
+
+# counters differ between models by design
+IGNORE_CSRS = [0xb00, 0xb02, 0xb80, 0xb82, 0xc00, 0xc01, 0xc02, 0xc80, 0xc81,
+               0xc82]
+
+SPIKE_COMMIT = re.compile(
+    rb'^core +\d+: +\d +0x([0-9a-f]+) +\(0x([0-9a-f]+)\)'
+    rb'(?: x(\d+) +0x([0-9a-f]+))?([^\n]*)', re.M
+)
+SPIKE_CSR = re.compile(rb' c(\d+)_\S+ +0x([0-9a-f]+)')
+SPIKE_CHUNK = 1 << 20
+
+DUT_COMMAND = (
+    '{sim} --variant {variant} --program {elf}'
+    ' --override riscvOVPsim/cpu/simulateexceptions=T'
+    ' --override riscvOVPsim/cpu/defaultsemihost=F'
+    ' --override riscvOVPsim/cpu/user_version=2.3'
+    ' --override riscvOVPsim/cpu/priv_version=1.11'
+    ' --override riscvOVPsim/cpu/signature_file={out}.dut.signature'
+    ' --override riscvOVPsim/cpu/commit_ring={ring}'
+)
+REF_COMMAND = (
+    'spike --isa={isa} -l --log-commits +signature={out}.ref.signature {elf}'
+)
+
+# fields of a commit, in ring record order
+PC, VALUE, CSR_VALUE, INSTRUCTION, RD, FLAGS, CSR = range(7)
+
+
+class CommitSource:
+    '''
+        Buffered source of commits, each a tuple in ring record order, which
+        are filled in batches by derived classes
+    '''
+
+    def __init__(self):
+        self.buffer = []
+
+    def fill(self):
+        '''
+            Append the next batch of commits to the buffer, returning False
+            at the end of the source
+        '''
+        return False
+
+    def batch(self):
+        '''
+            Return all buffered commits, waiting for the next batch if none
+            are buffered; an empty list marks the end of the source
+        '''
+        if not self.buffer:
+            self.fill()
+        result = self.buffer
+        self.buffer = []
+        return result
+
+    def take(self, count):
+        '''
+            Return the next count commits, or fewer at the end of the source
+        '''
+        while len(self.buffer) < count and self.fill():
+            pass
+        result = self.buffer[:count]
+        del self.buffer[:count]
+        return result
+
+    def skipTo(self, pc, limit):
+        '''
+            Discard up to limit commits before the first at the given PC,
+            returning the number discarded
+        '''
+        skipped = 0
+        while skipped < limit:
+            if not self.buffer and not self.fill():
+                break
+            if self.buffer[0][PC] == pc:
+                break
+            del self.buffer[0]
+            skipped += 1
+        return skipped
+
+
+class CommitRing(CommitSource):
+    '''
+        Reader for the commit ring written by a model process
+    '''
+
+    def __init__(self, path, process):
+        super().__init__()
+        self.process = process
+        self.tail = 0
+        self.complete = False
+
+        # the model creates the ring and writes the magic number last
+        while True:
+            if os.path.exists(path) and os.path.getsize(path) >= \
+                    RING_HEADER.size:
+                with open(path, 'r+b') as ring:
+                    self.map = mmap.mmap(ring.fileno(), 0)
+                if RING_HEADER.unpack_from(self.map)[0] == RING_MAGIC:
+                    break
+                self.map.close()
+            if process.poll() is not None:
+                raise RuntimeError('model did not create commit ring %s' %
+                                   path)
+            time.sleep(RING_POLL)
+
+        self.capacity, size = RING_HEADER.unpack_from(self.map)[1:3]
+        if size != RING_RECORD.size:
+            raise RuntimeError('commit ring %s has %d-byte records' %
+                               (path, size))
+
+    def read(self, offset, fmt='<Q'):
+        return struct.unpack_from(fmt, self.map, offset)[0]
+
+    def fill(self):
+        '''
+            Take every published record and release its space to the model
+        '''
+        while True:
+            # the model sets done after publishing its last record
+            done = self.read(RING_DONE, '<I')
+            head = self.read(RING_HEAD)
+
+            if head != self.tail:
+                break
+            elif done:
+                self.complete = True
+                return False
+            elif self.process.poll() is not None and \
+                    self.read(RING_HEAD) == self.tail:
+                return False
+            time.sleep(RING_POLL)
+
+        start = RING_HEADER.size
+        first = self.tail % self.capacity
+        last = first + head - self.tail
+        size = RING_RECORD.size
+
+        if last <= self.capacity:
+            data = self.map[start + first*size:start + last*size]
+        else:
+            data = self.map[start + first*size:] + \
+                self.map[start:start + (last - self.capacity)*size]
+
+        self.tail = head
+        struct.pack_into('<Q', self.map, RING_TAIL, head)
+
+        self.buffer.extend(RING_RECORD.iter_unpack(data))
+        return True
+
+    def stop(self):
+        struct.pack_into('<I', self.map, RING_STOP, 1)
+
+
+class SpikeLog(CommitSource):
+    '''
+        Reader for a spike commit log, which is read in large chunks so that
+        only commit lines are examined in Python
+    '''
+
+    def __init__(self, stream):
+        super().__init__()
+        self.stream = stream
+        self.partial = b''
+
+    def fill(self):
+        chunk = self.stream.read1(SPIKE_CHUNK)
+        if not chunk:
+            return False
+
+        # keep any incomplete last line for the next chunk
+        end = chunk.rfind(b'\n') + 1
+        text = self.partial + chunk[:end]
+        self.partial = chunk[end:] if end else self.partial + chunk
+
+        # an X register write is matched directly; any CSR writes follow
+        for pc, instruction, rd, value, rest in SPIKE_COMMIT.findall(text):
+            instruction = int(instruction, 16)
+            csr = csrValue = flags = 0
+
+            if rd and rd != b'0':
+                rd = int(rd)
+                value = int(value, 16)
+                flags = HAS_RD
+            else:
+                rd = value = 0
+
+            # prefer the CSR named by a CSR instruction
+            for number, data in SPIKE_CSR.findall(rest):
+                if not flags & HAS_CSR or csr != instruction >> 20:
+                    csr = int(number)
+                    csrValue = int(data, 16)
+                    flags |= HAS_CSR
+
+            self.buffer.append(
+                (int(pc, 16), value, csrValue, instruction, rd, flags, csr)
+            )
+
+        return True
+
+
+def isaNames(isa):
+    '''
+        Return the riscvOVPsim variant and spike ISA string for a suite name
+        such as rv32imc or rv32Zicsr
+    '''
+    match = re.match(r'rv(\d+)([a-z]*)', isa)
+    if not match:
+        raise RuntimeError('unknown ISA %s' % isa)
+
+    name = 'rv%s%s' % (match.group(1), match.group(2) or 'i')
+    return name.upper(), name, int(match.group(1))
+
+
+def differences(dut, ref, xlen, ignore):
+    '''
+        Return descriptions of the differences between two commits
+    '''
+    mask = (1 << xlen) - 1
+    dutInstr = dut[INSTRUCTION]
+    refInstr = ref[INSTRUCTION]
+    result = []
+
+    # compressed instructions are compared in their 16-bit form
+    if dutInstr & 3 != 3:
+        dutInstr &= 0xffff
+        refInstr &= 0xffff
+
+    if dut[PC] != ref[PC]:
+        result.append('PC')
+    elif dutInstr != refInstr:
+        result.append('instruction')
+    elif dut[RD] != ref[RD]:
+        result.append('destination register')
+    elif dut[RD] and ((dut[VALUE] ^ ref[VALUE]) & mask):
+        result.append('x%d value' % dut[RD])
+
+    # CSR writes are compared when both models report the same CSR
+    if dut[FLAGS] & ref[FLAGS] & HAS_CSR and dut[CSR] == ref[CSR] and \
+            dut[CSR] not in ignore and \
+            ((dut[CSR_VALUE] ^ ref[CSR_VALUE]) & mask):
+        result.append('CSR 0x%03x value' % dut[CSR])
+
+    return result
+
+
+def formatCommit(commit, xlen):
+    '''
+        Return a one-line description of a commit
+    '''
+    if commit is None:
+        return 'no instruction'
+
+    digits = xlen // 4
+    mask = (1 << xlen) - 1
+    text = '0x%0*x (0x%08x)' % (digits, commit[PC], commit[INSTRUCTION])
+    if commit[FLAGS] & HAS_RD:
+        text += ' x%-2d 0x%0*x' % (commit[RD], digits, commit[VALUE] & mask)
+    if commit[FLAGS] & HAS_CSR:
+        text += ' c%03x 0x%0*x' % (commit[CSR], digits,
+                                   commit[CSR_VALUE] & mask)
+    return text
+
+
+def compare(name, dut, ref, args, xlen):
+    '''
+        Compare commits of the model under test and the reference in lockstep,
+        returning True if they match. Each published batch of the model under
+        test is first compared as a whole with the same number of reference
+        commits, and only examined commit by commit if they differ
+    '''
+    ignore = set(IGNORE_CSRS + args.ignore_csr)
+    history = collections.deque(maxlen=args.context)
+    dutCommit = refCommit = None
+    skipped = 0
+    count = 0
+    problem = None
+
+    batch = dut.batch()
+
+    # skip reference boot code
+    if batch:
+        skipped = ref.skipTo(batch[0][PC], args.sync_limit)
+
+    while batch and not problem:
+        refs = ref.take(len(batch))
+
+        if batch == refs:
+            count += len(batch)
+            if args.context:
+                history.extend(zip(batch[-args.context:],
+                                   refs[-args.context:]))
+        else:
+            for index, dutCommit in enumerate(batch):
+                refCommit = refs[index] if index < len(refs) else None
+                if refCommit is None:
+                    problem = ['reference ended']
+                elif dutCommit != refCommit:
+                    problem = differences(dutCommit, refCommit, xlen, ignore)
+                if problem:
+                    break
+                history.append((dutCommit, refCommit))
+                count += 1
+
+        batch = dut.batch()
+
+    if not problem and not dut.complete:
+        problem = ['riscvOVPsim ended without completing the commit ring']
+        dutCommit = refCommit = None
+
+    if not problem:
+        print('%-32s OK %d instructions' % (name, count))
+        return True
+
+    print('%-32s DIVERGES at instruction %d (%s)' %
+          (name, count, ', '.join(problem)))
+    if skipped:
+        print('    %d reference boot instructions skipped' % skipped)
+
+    width = len(formatCommit(history[-1][0] if history else dutCommit, xlen))
+    width = max(width, 24)
+    print('    %8s  %-*s | %s' % ('', width, 'riscvOVPsim', 'reference'))
+    for index, (dutEntry, refEntry) in enumerate(history):
+        print('    %8d  %-*s | %s' % (
+            count - len(history) + index, width, formatCommit(dutEntry, xlen),
+            formatCommit(refEntry, xlen)
+        ))
+    print('  > %8d  %-*s | %s' % (count, width, formatCommit(dutCommit, xlen),
+                                  formatCommit(refCommit, xlen)))
+    return False
+
+
+def stopProcess(process):
+    '''
+        End a model process
+    '''
+    if process.poll() is None:
+        process.kill()
+    process.wait()
+
+
+def cosim(args, elf, variant, isa, xlen):
+    '''
+        Run one ELF on both models, returning True if they match
+    '''
+    name = os.path.basename(elf)
+    if name.endswith('.elf'):
+        name = name[:-4]
+
+    shared = '/dev/shm' if os.path.isdir('/dev/shm') else None
+    temp = tempfile.mkdtemp(prefix='cosim.', dir=shared)
+    fields = {
+        'sim': args.sim,
+        'variant': variant,
+        'isa': isa,
+        'elf': os.path.abspath(elf),
+        'ring': os.path.join(temp, name + '.ring'),
+        'refring': os.path.join(temp, name + '.ref.ring'),
+        'out': os.path.join(temp, name),
+    }
+    log = os.path.splitext(elf)[0] + '.cosim.log'
+    processes = []
+
+    try:
+        with open(log, 'w') as logFile:
+            dutProcess = subprocess.Popen(
+                args.dut.format(**fields), shell=True, stdin=subprocess.DEVNULL,
+                stdout=logFile, stderr=subprocess.STDOUT
+            )
+            processes.append(dutProcess)
+
+            if args.ref_ring:
+                refProcess = subprocess.Popen(
+                    args.ref.format(**fields), shell=True,
+                    stdin=subprocess.DEVNULL, stdout=logFile,
+                    stderr=subprocess.STDOUT
+                )
+                processes.append(refProcess)
+                ref = CommitRing(fields['refring'], refProcess)
+            else:
+                refProcess = subprocess.Popen(
+                    args.ref.format(**fields), shell=True,
+                    stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                    stderr=subprocess.PIPE
+                )
+                processes.append(refProcess)
+                ref = SpikeLog(refProcess.stderr)
+
+            dut = CommitRing(fields['ring'], dutProcess)
+            ok = compare(name, dut, ref, args, xlen)
+
+            # end both models at the first divergence
+            if not ok:
+                dut.stop()
+                if args.ref_ring:
+                    ref.stop()
+
+    except RuntimeError as error:
+        print('%-32s ERROR %s, see %s' % (name, error, log))
+        ok = False
+
+    finally:
+        for process in processes:
+            stopProcess(process)
+        if args.keep:
+            print('    outputs kept in %s' % temp)
+        else:
+            shutil.rmtree(temp, ignore_errors=True)
+
+    return ok
+
+
+def main():
+    root = os.environ.get(
+        'ROOTDIR', os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    )
+    sim = os.environ.get('TARGET_SIM') or os.path.join(
+        root, 'riscv-ovpsim', 'bin', 'Linux64', 'riscvOVPsim.exe'
+    )
+
+    parser = argparse.ArgumentParser(
+        description='Run riscvOVPsim and a reference model in lockstep, '
+                    'stopping each test at the first divergence'
+    )
+    parser.add_argument('--isa', required=True, metavar='<isa>',
+                        help='test suite ISA, e.g. rv32imc')
+    parser.add_argument('--sim', default=sim, metavar='<file>',
+                        help='riscvOVPsim executable (default %(default)s)')
+    parser.add_argument('--dut', metavar='<command>',
+                        default=os.environ.get('COSIM_DUT') or DUT_COMMAND,
+                        help='riscvOVPsim command template (COSIM_DUT)')
+    parser.add_argument('--ref', metavar='<command>',
+                        default=os.environ.get('COSIM_REF') or REF_COMMAND,
+                        help='reference model command template (COSIM_REF, '
+                             'default spike)')
+    parser.add_argument('--ref-ring', action='store_true',
+                        help='reference model writes a commit ring to '
+                             '{refring} instead of a spike commit log')
+    parser.add_argument('--context', type=int, default=8, metavar='<n>',
+                        help='matching instructions shown before a '
+                             'divergence (default %(default)s)')
+    parser.add_argument('--sync-limit', type=int, default=10000,
+                        metavar='<n>',
+                        help='reference boot instructions that may be '
+                             'skipped (default %(default)s)')
+    parser.add_argument('--ignore-csr', type=lambda x: int(x, 0),
+                        action='append', default=[], metavar='<csr>',
+                        help='CSR number whose value is not compared, in '
+                             'addition to the counters')
+    parser.add_argument('--keep', action='store_true',
+                        help='keep signatures and rings of each run')
+    parser.add_argument('elfs', nargs='+', metavar='<elf>',
+                        help='test programs')
+
+    args = parser.parse_args()
+    variant, isa, xlen = isaNames(args.isa)
+
+    failed = 0
+    for elf in args.elfs:
+        if not cosim(args, elf, variant, isa, xlen):
+            failed += 1
+
+    print('%d of %d tests match' % (len(args.elfs) - failed, len(args.elfs)))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -34,29 +34,47 @@ if [[ ${COVERTYPE} == "" ]]; then
     COVERTYPE=basic
 fi
 
-ALL_ISA=$(ls -1 work)
-for ISA in ${ALL_ISA}; do
-    echo "Running $ISA"
-    RISCV_ISA=${ISA}
-    RISCV_CVG=${map[${RISCV_ISA}]}
-    RISCV_VARIANT=${varMap[${RISCV_ISA}]}
+#
+# Merge the per-test binary coverage written during the test runs or, if
+# there is none, rerun coverage over the per-test YAML files. Each ISA is
+# processed in parallel
+#
+cover() {
+    local ISA=$1
+    local RISCV_CVG=${map[${ISA}]}
+    local RISCV_VARIANT=${varMap[${ISA}]}
+    local COV=$(ls work/${ISA}/*.${COVERTYPE}.cov 2> /dev/null)
+
+    if [ -n "${COV}" ]; then
+        echo "Merging $ISA"
+        ${ROOTDIR}/riscv-test-env/covertools.py merge \
+            --report work/${ISA}/${COVERTYPE}.coverage.txt \
+            --yaml work/${ISA}/${COVERTYPE}.coverage.merged.yaml \
+            --countthreshold 1 \
+            ${COV} 2> work/${ISA}/${COVERTYPE}.coverage.run.log
+        return
+    fi
 
     if [ -z "${RISCV_CVG}" ]; then
         echo "Skipping $ISA"
-        continue
+        return
     fi
+
+    echo "Running $ISA"
     ${ROOTDIR}/riscv-ovpsim/bin/Linux64/riscvOVPsim.exe \
         --cover ${COVERTYPE} \
         --variant ${RISCV_VARIANT} \
         --extensions ${RISCV_CVG} \
-        --inputfiles work/${RISCV_ISA} \
-        --outputfile work/${RISCV_ISA}/${COVERTYPE}.coverage.yaml \
-        --reportfile work/${RISCV_ISA}/${COVERTYPE}.coverage.txt \
+        --inputfiles work/${ISA} \
+        --outputfile work/${ISA}/${COVERTYPE}.coverage.yaml \
+        --reportfile work/${ISA}/${COVERTYPE}.coverage.txt \
         --countthreshold 1 \
         --showuncovered \
-        --nosimulation --logfile work/${RISCV_ISA}/${COVERTYPE}.coverage.run.log
-    
-done
-
+        --nosimulation --logfile work/${ISA}/${COVERTYPE}.coverage.run.log
+}
 
-   
+ALL_ISA=$(ls -1 work)
+for ISA in ${ALL_ISA}; do
+    cover ${ISA} &
+done
+wait
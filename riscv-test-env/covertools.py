@@ -0,0 +1,494 @@
+#!/usr/bin/env python3
+
+# Copyright Imperas Software Ltd
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''
+    Tools for per-test riscvOVPsim instruction coverage reports
+
+    pack        convert a coverage text report to compact binary form
+    merge       combine text or binary coverage files into a text report and
+                a YAML count tree
+    minimise    select a minimal subset of tests (greedy set cover) that hits
+                every coverage point hit by the full set of tests
+
+    A binary coverage file holds, in order: the magic string, the SHA-1
+    digest of the layout, the length of the zlib-compressed layout (the
+    "<point> <threshold>" lines in point order), the compressed layout, the
+    number of points, one count per point, the number of extensions and, for
+    each, the length of its name, the name and the number of instructions
+    counted. All integers are 32-bit little endian except instruction counts,
+    which are 64-bit. Files with the same layout are merged by adding count
+    arrays.
+'''
+
+import argparse
+import array
+import hashlib
+import operator
+import os
+import re
+import struct
+import sys
+import zlib
+
+COUNT_LINE = re.compile(r'^( *)(\S+) +(\d+)/(\d+) : +[\d.]+%( .*)?$')
+GROUP_LINE = re.compile(r'^( *)(\S+) *$')
+START_LINE = re.compile(r'^(?:Extension : ([^,]+),|Instructions: )')
+TOTAL_LINE = re.compile(r'^Info +Instructions counted +: +(\d+)')
+
+
+def parseReport(path, counted=None):
+    '''
+        Return {point: (count, threshold)} from a coverage text report, where
+        point is "<extension>/<instruction>/.../<bin>", adding the number of
+        instructions counted for each extension to counted if given
+    '''
+    points = {}
+    section = extension = None
+    groups = []
+
+    with open(path) as report:
+        for line in report:
+            line = line.rstrip()
+
+            match = START_LINE.match(line)
+            if match:
+                section = extension = match.group(1) or ''
+                groups = []
+                continue
+
+            match = TOTAL_LINE.match(line)
+            if match and section is not None and counted is not None:
+                counted[section] = (counted.get(section, 0) +
+                                    int(match.group(1)))
+                continue
+
+            # the missed point list and summary end the section
+            if line.startswith('Coverage points missed'):
+                extension = None
+                continue
+
+            match = COUNT_LINE.match(line)
+            if match and extension is not None:
+                indent, name = len(match.group(1)), match.group(2)
+                value = (int(match.group(3)), int(match.group(4)))
+                if groups and groups[-1][:2] == [indent, name]:
+                    # group summary line: a group without children (such as
+                    # an instruction without operands) is itself a point
+                    if groups.pop()[2]:
+                        continue
+                elif groups:
+                    groups[-1][2] += 1
+                path = [extension] + [g[1] for g in groups] + [name]
+                points['/'.join(path)] = value
+                continue
+
+            match = GROUP_LINE.match(line)
+            if match and extension is not None:
+                if groups:
+                    groups[-1][2] += 1
+                groups.append([len(match.group(1)), match.group(2), 0])
+
+    return points
+
+
+COV_MAGIC = b'RVCOV2\n'
+COV_MAGIC_V1 = b'RVCOV1\n'
+
+
+def writeBinary(points, counted, path):
+    '''
+        Write {point: (count, threshold)} and {extension: instructions
+        counted} as a binary coverage file
+    '''
+    names = sorted(points)
+    layout = ''.join('%s %d\n' % (n, points[n][1]) for n in names).encode()
+    packed = zlib.compress(layout)
+    counts = array.array('I', (points[n][0] for n in names))
+    if sys.byteorder != 'little':
+        counts.byteswap()
+
+    temp = path + '.%d' % os.getpid()
+    with open(temp, 'wb') as output:
+        output.write(COV_MAGIC)
+        output.write(hashlib.sha1(layout).digest())
+        output.write(struct.pack('<I', len(packed)))
+        output.write(packed)
+        output.write(struct.pack('<I', len(names)))
+        output.write(counts.tobytes())
+        output.write(struct.pack('<I', len(counted)))
+        for extension in sorted(counted):
+            name = extension.encode()
+            output.write(struct.pack('<I', len(name)))
+            output.write(name)
+            output.write(struct.pack('<Q', counted[extension]))
+    os.replace(temp, path)
+
+
+def readBinary(path, layouts, counted=None):
+    '''
+        Return (layout, counts) from a binary coverage file, where layout is
+        a list of (point, threshold) shared by files with the same digest
+        through the layouts cache, adding the number of instructions counted
+        for each extension to counted if given
+    '''
+    with open(path, 'rb') as cov:
+        magic = cov.read(len(COV_MAGIC))
+        if magic not in (COV_MAGIC, COV_MAGIC_V1):
+            raise ValueError('%s: not a binary coverage file' % path)
+        digest = cov.read(20)
+        size, = struct.unpack('<I', cov.read(4))
+        if digest in layouts:
+            cov.seek(size, os.SEEK_CUR)
+        else:
+            lines = zlib.decompress(cov.read(size)).decode().splitlines()
+            layouts[digest] = [
+                (p, int(t)) for p, t in (l.rsplit(' ', 1) for l in lines)
+            ]
+        num, = struct.unpack('<I', cov.read(4))
+        counts = array.array('I')
+        counts.frombytes(cov.read(4 * num))
+        if sys.byteorder != 'little':
+            counts.byteswap()
+        # files written before instruction counts were recorded have none
+        num, = struct.unpack('<I', cov.read(4)) if magic == COV_MAGIC else (0,)
+        for _ in range(num):
+            size, = struct.unpack('<I', cov.read(4))
+            extension = cov.read(size).decode()
+            total, = struct.unpack('<Q', cov.read(8))
+            if counted is not None:
+                counted[extension] = counted.get(extension, 0) + total
+
+    return layouts[digest], counts
+
+
+def readCoverage(path, layouts=None):
+    '''
+        Return {point: (count, threshold)} from a text or binary coverage file
+    '''
+    if not path.endswith('.cov'):
+        return parseReport(path)
+
+    layout, counts = readBinary(path, {} if layouts is None else layouts)
+    return {p: (c, t) for (p, t), c in zip(layout, counts)}
+
+
+def coverageKind(path):
+    '''
+        Return (test, type) from "<test>.<type>.coverage.txt" or
+        "<test>.<type>.cov"
+    '''
+    name = os.path.basename(path)
+    for suffix in ('.coverage.txt', '.txt', '.cov'):
+        if name.endswith(suffix):
+            name = name[:-len(suffix)]
+            break
+    # test names may contain dots (I-FENCE.I-01), types do not
+    test, _, kind = name.rpartition('.')
+    return test, kind
+
+
+def testReports(paths):
+    '''
+        Group coverage files by test, returning
+        {test: {"<type>/<point>": (count, threshold)}}
+    '''
+    tests = {}
+    layouts = {}
+
+    for path in paths:
+        test, kind = coverageKind(path)
+        points = tests.setdefault(test, {})
+        for point, value in readCoverage(path, layouts).items():
+            points[kind + '/' + point] = value
+
+    return tests
+
+
+def hitPoints(points):
+    '''
+        Return the set of points that reach their threshold
+    '''
+    return {p for p, (count, threshold) in points.items() if count >= threshold}
+
+
+def mergeFiles(paths):
+    '''
+        Return ({point: (count, threshold)}, {extension: instructions
+        counted}) summed over coverage files. Count arrays of binary files
+        with the same layout are summed directly
+    '''
+    layouts = {}
+    sums = {}
+    points = {}
+    counted = {}
+
+    for path in paths:
+        if path.endswith('.cov'):
+            layout, counts = readBinary(path, layouts, counted)
+            key = id(layout)
+            if key in sums:
+                total = sums[key][1]
+                sums[key] = (layout, array.array(
+                    'Q', map(operator.add, total, counts)
+                ))
+            else:
+                sums[key] = (layout, array.array('Q', counts))
+        else:
+            for point, (count, threshold) in \
+                    parseReport(path, counted).items():
+                old = points.get(point, (0, threshold))
+                points[point] = (old[0] + count, threshold)
+
+    for layout, total in sums.values():
+        for (point, threshold), count in zip(layout, total):
+            old = points.get(point, (0, threshold))
+            points[point] = (old[0] + count, threshold)
+
+    return points, counted
+
+
+def buildTree(points):
+    '''
+        Return {extension: tree} where each tree node is a dict of children
+        and each leaf is a (count, threshold) tuple
+    '''
+    trees = {}
+
+    for point, value in points.items():
+        path = point.split('/')
+        node = trees.setdefault(path[0], {})
+        for name in path[1:-1]:
+            node = node.setdefault(name, {})
+        node[path[-1]] = value
+
+    return trees
+
+
+def leafCounts(node):
+    '''
+        Return (hit, total) over the leaves below a tree node
+    '''
+    if isinstance(node, tuple):
+        return (1 if node[0] >= node[1] else 0), 1
+
+    hit = total = 0
+    for child in node.values():
+        h, t = leafCounts(child)
+        hit += h
+        total += t
+    return hit, total
+
+
+def percent(hit, total):
+    return 100.0 * hit / total if total else 0.0
+
+
+def writeNode(output, name, node, depth, missed, path):
+    '''
+        Write a tree node in coverage report format, collecting missed points
+    '''
+    indent = '    ' * depth
+
+    if isinstance(node, tuple) and depth > 1:
+        count, threshold = node
+        zero = ' ZERO' if not count else ''
+        output.write('%s%-10s %3d/%d : %6.2f%%%s\n' % (
+            indent, name, count, threshold,
+            percent(min(count, threshold), threshold), zero
+        ))
+        if count < threshold:
+            missed.append('/'.join(path + [name]))
+        return
+
+    output.write('%s%-15s\n' % (indent, name))
+
+    if isinstance(node, tuple):
+        # instruction without operands
+        hit, total = leafCounts(node)
+        if not hit:
+            missed.append('/'.join(path + [name]))
+    else:
+        for child in sorted(node):
+            writeNode(output, child, node[child], depth + 1, missed,
+                      path + [name])
+        hit, total = leafCounts(node)
+
+    output.write('%s%s %d/%d : %6.2f%%\n' % (
+        indent, name, hit, total, percent(hit, total)
+    ))
+
+
+def writeReport(points, counted, path, threshold):
+    '''
+        Write merged coverage in riscvOVPsim text report format
+    '''
+    with open(path, 'w') as output:
+        output.write('Imperas RISC-V Instruction Coverage Report\n\n')
+
+        for extension, tree in sorted(buildTree(points).items()):
+            missed = []
+
+            if extension:
+                output.write('Extension : %s, instructions: %d\n' %
+                             (extension, len(tree)))
+            else:
+                output.write('Instructions: %d\n' % len(tree))
+
+            for name in sorted(tree):
+                writeNode(output, name, tree[name], 1, missed, [])
+
+            hit, total = leafCounts(tree)
+            seen = sum(1 for node in tree.values() if leafCounts(node)[0])
+
+            if missed:
+                output.write('Coverage points missed:\n')
+            for point in missed:
+                output.write('  %s\n' % point)
+            output.write('Coverage points missed: %d/%d\n\n' %
+                         (len(missed), total))
+            output.write('Info TOTAL INSTRUCTION COVERAGE : %s\n' % extension)
+            output.write('Info   Threshold             : %d\n' % threshold)
+            output.write('Info   Instructions counted  : %d\n' %
+                         counted.get(extension, 0))
+            output.write('Info   Unique instructions   : %d/%d : %6.2f%%\n' %
+                         (seen, len(tree), percent(seen, len(tree))))
+            output.write('Info   Coverage points hit   : %d/%d : %6.2f%%\n' %
+                         (hit, total, percent(hit, total)))
+
+
+def writeYAML(points, path):
+    '''
+        Write merged coverage counts as a YAML tree
+    '''
+    def writeTree(output, node, depth):
+        for name in sorted(node):
+            child = node[name]
+            if isinstance(child, tuple):
+                output.write('%s%s: %d\n' % ('  ' * depth, name, child[0]))
+            else:
+                output.write('%s%s:\n' % ('  ' * depth, name))
+                writeTree(output, child, depth + 1)
+
+    with open(path, 'w') as output:
+        output.write('coverage:\n')
+        trees = buildTree(points)
+        writeTree(output, {e or 'all': t for e, t in trees.items()}, 1)
+
+
+def pack(args):
+    '''
+        Convert a coverage text report to binary form
+    '''
+    counted = {}
+    points = parseReport(args.report, counted)
+    writeBinary(points, counted, args.output)
+
+
+def merge(args):
+    '''
+        Merge coverage files into a text report and a YAML count tree
+    '''
+    points, counted = mergeFiles(args.files)
+
+    if args.countthreshold:
+        threshold = args.countthreshold
+        points = {p: (c, threshold) for p, (c, t) in points.items()}
+    else:
+        thresholds = {t for c, t in points.values()}
+        threshold = thresholds.pop() if len(thresholds) == 1 else 1
+
+    if args.report:
+        writeReport(points, counted, args.report, threshold)
+    if args.yaml:
+        writeYAML(points, args.yaml)
+
+    hit = sum(1 for c, t in points.values() if c >= t)
+    print('Merged %d files: %d/%d coverage points hit' %
+          (len(args.files), hit, len(points)), file=sys.stderr)
+
+
+def minimise(args):
+    '''
+        Greedy set cover: repeatedly select the test hitting most points not
+        yet hit (ties broken by test name) until every point is hit
+    '''
+    tests = {t: hitPoints(p) for t, p in testReports(args.reports).items()}
+    remaining = set().union(*tests.values()) if tests else set()
+    total = len(remaining)
+    selected = []
+
+    while remaining:
+        best = min(tests, key=lambda t: (-len(tests[t] & remaining), t))
+        selected.append(best)
+        remaining -= tests.pop(best)
+
+    selected.sort()
+
+    output = open(args.output, 'w') if args.output else sys.stdout
+    for test in selected:
+        output.write(test + '\n')
+    if args.output:
+        output.close()
+
+    print('%d of %d tests hit all %d coverage points' %
+          (len(selected), len(selected) + len(tests), total), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Tools for per-test riscvOVPsim coverage reports'
+    )
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    command = commands.add_parser(
+        'minimise', help='select a minimal subset of tests preserving coverage'
+    )
+    command.add_argument('--output', metavar='<file>',
+                         help='write test list to file (default stdout)')
+    command.add_argument('reports', nargs='+', metavar='<report>',
+                         help='per-test <test>.<type>.coverage.txt reports '
+                              'or <test>.<type>.cov files')
+    command.set_defaults(function=minimise)
+
+    command = commands.add_parser(
+        'pack', help='convert a coverage text report to binary form'
+    )
+    command.add_argument('report', metavar='<report>',
+                         help='coverage text report')
+    command.add_argument('output', metavar='<file>',
+                         help='binary coverage file to write')
+    command.set_defaults(function=pack)
+
+    command = commands.add_parser(
+        'merge', help='merge coverage files into text and YAML reports'
+    )
+    command.add_argument('--report', metavar='<file>',
+                         help='write merged text report')
+    command.add_argument('--yaml', metavar='<file>',
+                         help='write merged YAML count tree')
+    command.add_argument('--countthreshold', type=int, metavar='<count>',
+                         help='count at which a point is hit (default: the '
+                              'threshold of the per-test reports)')
+    command.add_argument('files', nargs='+', metavar='<file>',
+                         help='text reports or binary (.cov) coverage files')
+    command.set_defaults(function=merge)
+
+    args = parser.parse_args()
+    args.function(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+#!/bin/bash
+
+#
+# Run tests in persistent riscvOVPsim processes.
+#
+#   ovpsim-server.sh run <dir> <elf> <signature> <simulator command...>
+#   ovpsim-server.sh stop <dir>
+#
+# "run" sends the test to an idle simulator from a pool kept in <dir> for
+# the given simulator command, waits for it to complete and prints the
+# reply. The pool holds up to ${OVPSIM_SERVER_POOL} (default: number of host
+# CPUs) simulators per distinct command, each started on first use with
+# batch_socket set so that it loads and runs one ELF per request without
+# being restarted. "stop" ends every simulator in <dir>.
+#
+# Requests are sent with socat or, failing that, nc -U. Tests that run past
+# the batch_instruction_limit given in the simulator command fail in the
+# simulator; as a last resort, a request with no reply within
+# ${OVPSIM_SERVER_TIMEOUT} seconds (default 3600) fails and its simulator is
+# ended, to be restarted by the next request.
+#
+
+OP=$1
+DIR=$2
+
+if [ -z "${OVPSIM_SERVER_POOL}" ]; then
+    OVPSIM_SERVER_POOL=$(nproc 2> /dev/null || echo 1)
+fi
+if [ -z "${OVPSIM_SERVER_TIMEOUT}" ]; then
+    OVPSIM_SERVER_TIMEOUT=3600
+fi
+
+#
+# Send a request line to a socket and print the reply, giving up after
+# ${OVPSIM_SERVER_TIMEOUT} seconds
+#
+request() {
+    if command -v socat > /dev/null; then
+        echo "$2" | socat -t ${OVPSIM_SERVER_TIMEOUT} \
+            -T ${OVPSIM_SERVER_TIMEOUT} - UNIX-CONNECT:$1
+    else
+        echo "$2" | nc -w ${OVPSIM_SERVER_TIMEOUT} -U $1
+    fi
+}
+
+#
+# Start pool instance $1 of the simulator command $2..., waiting until its
+# socket is ready
+#
+start() {
+    local inst=${BASE}.$1
+    local pid
+    shift
+
+    rm -f ${inst}.sock
+    "$@" --override riscvOVPsim/cpu/batch_socket=${inst}.sock \
+        < /dev/null > ${inst}.log 2>&1 9>&- &
+    pid=$!
+    echo ${pid} > ${inst}.pid
+
+    while [ ! -S ${inst}.sock ]; do
+        if ! kill -0 ${pid} 2> /dev/null; then
+            echo "Error: simulator failed to start, see ${inst}.log"
+            exit 1
+        fi
+        sleep 0.1
+    done
+}
+
+#
+# Lock an idle pool instance (or wait for a busy one) on file descriptor 9,
+# starting it if it is not running, and set SOCK to its socket
+#
+acquire() {
+    local i
+
+    for ((i=0; i<${OVPSIM_SERVER_POOL}; i++)); do
+        exec 9> ${BASE}.${i}.busy
+        flock -n 9 && break
+    done
+
+    if [ ${i} -eq ${OVPSIM_SERVER_POOL} ]; then
+        i=$((RANDOM % ${OVPSIM_SERVER_POOL}))
+        exec 9> ${BASE}.${i}.busy
+        flock 9
+    fi
+
+    INST=${BASE}.${i}
+    SOCK=${INST}.sock
+
+    if [ ! -S ${SOCK} ] || ! kill -0 $(cat ${BASE}.${i}.pid) 2> /dev/null
+    then
+        start ${i} "$@"
+    fi
+}
+
+case ${OP} in
+    run)
+        ELF=$(realpath $3)
+        SIG=$(realpath -m $4)
+        shift 4
+        mkdir -p ${DIR}
+        BASE=${DIR}/$(echo "$*" | sha256sum | cut -c1-12)
+
+        acquire "$@"
+        REPLY=$(request ${SOCK} "${ELF} ${SIG}")
+
+        # a simulator that did not reply in time is ended
+        if [ -z "${REPLY}" ]; then
+            kill $(cat ${INST}.pid) 2> /dev/null
+            rm -f ${SOCK}
+            REPLY="ERROR ${ELF} (no reply within ${OVPSIM_SERVER_TIMEOUT}s)"
+        fi
+
+        echo "${REPLY}"
+        [[ "${REPLY}" == OK* ]]
+        ;;
+    stop)
+        for pid in ${DIR}/*.pid; do
+            [ -f ${pid} ] || continue
+            SOCK=${pid%.pid}.sock
+            [ -S ${SOCK} ] && request ${SOCK} "quit" > /dev/null
+            kill $(cat ${pid}) 2> /dev/null
+            rm -f ${pid} ${SOCK} ${pid%.pid}.busy
+        done
+        ;;
+    *)
+        echo "usage: $0 run <dir> <elf> <signature> <command...>" >&2
+        echo "       $0 stop <dir>" >&2
+        exit 2
+        ;;
+esac
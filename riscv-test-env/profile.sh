@@ -0,0 +1,125 @@
+#!/bin/bash
+
+#
+# Record the run profile of each test and flag cost regressions.
+#
+#   profile.sh <isa>...
+#
+# Each <test>.profile.json written by a run (riscvOVPsim parameter
+# run_profile) in ${WORK}/<isa> is appended, with the test, variant, target
+# and model version, as one JSON line to ${PROFILE_HISTORY}. The model
+# version is ${MODEL_VERSION} or else a hash of ${TARGET_SIM}. The profile
+# file is then removed, so results restored from the result cache are not
+# recorded twice.
+#
+# A test is flagged when its host wall time (load, simulation and dump) or
+# simulated instruction count exceeds that of the previous record for the
+# same test, variant and target by more than ${PROFILE_THRESHOLD} percent
+# (default 20), ignoring host time differences below 10ms. Phase totals are
+# reported for the tests recorded; startup is host CPU time, as the wall time
+# before the model is constructed is not known. The exit status is non-zero
+# if a test is flagged and PROFILE_FAIL=1.
+#
+
+if [ -z "${PROFILE_HISTORY}" ]; then
+    PROFILE_HISTORY=${RESULT_CACHE:-${WORK}}/profile.history.json
+fi
+if [ -z "${PROFILE_THRESHOLD}" ]; then
+    PROFILE_THRESHOLD=20
+fi
+if [ -z "${MODEL_VERSION}" ]; then
+    if [ -z "${TARGET_SIM}" ] && [ "${RISCV_TARGET}" == "riscvOVPsim" ]; then
+        TARGET_SIM=${ROOTDIR}/riscv-ovpsim/bin/Linux64/riscvOVPsim.exe
+    fi
+    SIM=$(command -v "${TARGET_SIM}" 2> /dev/null)
+    if [ -n "${SIM}" ]; then
+        MODEL_VERSION=$(sha256sum < ${SIM} | cut -c1-12)
+    else
+        MODEL_VERSION=unknown
+    fi
+fi
+
+NEW=$(mktemp)
+trap 'rm -f ${NEW}' EXIT
+
+for isa in "$@"; do
+    for prof in ${WORK}/${isa}/*.profile.json; do
+        [ -f ${prof} ] || continue
+        test=$(basename ${prof} .profile.json)
+        echo -n "{\"test\": \"${test}\", \"variant\": \"${isa}\", "
+        echo -n "\"target\": \"${RISCV_TARGET}\", "
+        echo -n "\"model\": \"${MODEL_VERSION}\", "
+        echo -n "\"date\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\", "
+        sed 's/^{//' ${prof}
+        rm -f ${prof}
+    done
+done > ${NEW}
+
+if [ ! -s ${NEW} ]; then
+    exit 0
+fi
+
+mkdir -p $(dirname ${PROFILE_HISTORY})
+touch ${PROFILE_HISTORY}
+
+printf "\n\nRun profile ... \n\n"
+
+awk -v threshold=${PROFILE_THRESHOLD} '
+    BEGIN {
+        split("startup_cpu load simulate dump", phases, " ")
+    }
+    function field(name,    v) {
+        if(!match($0, "\"" name "\": \"?[^,\"}]*")) return ""
+        v = substr($0, RSTART, RLENGTH)
+        sub(/^"[^"]*": "?/, "", v)
+        return v
+    }
+    function host() {
+        return field("load")+0 + field("simulate")+0 + field("dump")+0
+    }
+    {
+        key     = field("test") " " field("variant") " " field("target")
+        time    = host()
+        instr   = field("instructions")+0
+    }
+    FILENAME == ARGV[1] {
+        lastTime[key]  = time
+        lastInstr[key] = instr
+        lastModel[key] = field("model")
+        next
+    }
+    {
+        tests++
+        for(p = 1; p <= 4; p++) {
+            total[p] += field(phases[p])+0
+        }
+
+        if(key in lastTime) {
+            slow = (time - lastTime[key] > 0.01) &&
+                   (time > lastTime[key] * (1 + threshold/100))
+            more = (instr > lastInstr[key] * (1 + threshold/100))
+            if(slow || more) {
+                printf "Regression %-28s %.3fs -> %.3fs, ",
+                    field("variant") "/" field("test"), lastTime[key], time
+                printf "%d -> %d instructions (model %s -> %s)\n",
+                    lastInstr[key], instr, lastModel[key], field("model")
+                regressions++
+            }
+        }
+    }
+    END {
+        printf "Phase totals for %d tests: startup %.3fs CPU, load %.3fs, ",
+            tests, total[1], total[2]
+        printf "simulate %.3fs, dump %.3fs\n", total[3], total[4]
+        printf "%d regressions (threshold %d%%)\n", regressions, threshold
+        exit (regressions > 0)
+    }
+' ${PROFILE_HISTORY} ${NEW}
+status=$?
+
+cat ${NEW} >> ${PROFILE_HISTORY}
+
+if [ "${PROFILE_FAIL}" == "1" ]; then
+    exit ${status}
+fi
+exit 0
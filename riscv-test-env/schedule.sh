@@ -0,0 +1,110 @@
+#!/bin/bash
+
+#
+# Run every test of every given variant from one global queue, then verify
+# each variant.
+#
+#   schedule.sh <isa>...
+#
+# Tests are started longest-first using the run times recorded in
+# ${SCHEDULE_TIMES}; tests with no recorded time are started first. Up to
+# ${SCHEDULE_JOBS} tests (default: number of host CPUs) run at once, and each
+# worker takes the next test from the shared queue as soon as it is idle, so
+# no core waits for the end of a variant. Set SCHEDULE_JOBS=1 for targets
+# that cannot run concurrently. Run profiles are recorded at the end.
+#
+
+if [ -z "${SCHEDULE_JOBS}" ]; then
+    SCHEDULE_JOBS=$(nproc 2> /dev/null || echo 1)
+fi
+if [ -z "${SCHEDULE_TIMES}" ]; then
+    SCHEDULE_TIMES=${RESULT_CACHE:-${WORK}}/schedule.times
+fi
+
+QUEUE=$(mktemp -d)
+trap 'rm -rf ${QUEUE}' EXIT
+
+#
+# Build the queue as "isa test seconds" lines, saving the settings shared by
+# every test of each variant so that they are not recomputed for each test
+#
+for isa in "$@"; do
+    output=$(${MAKE:-make} -s -C ${ROOTDIR}/riscv-test-suite/${isa} \
+        RISCV_DEVICE=${isa} RISCV_ISA=${isa} tests settings) || exit 1
+    tests=$(echo "${output}" | head -1)
+    echo "${output}" | tail -1 > ${QUEUE}/${isa}.settings
+    for test in ${tests}; do
+        echo "${isa} ${test}"
+    done
+done > ${QUEUE}/jobs
+
+if [ -f ${SCHEDULE_TIMES} ]; then
+    cp ${SCHEDULE_TIMES} ${QUEUE}/times
+else
+    touch ${QUEUE}/times
+fi
+
+awk -v target=${RISCV_TARGET} '
+    FILENAME == ARGV[1] { if($1 == target) t[$2 " " $3] = $4; next }
+    { print $1, $2, (($0 in t) ? t[$0] : "inf") }
+' ${QUEUE}/times ${QUEUE}/jobs | sort -k3,3gr > ${QUEUE}/queue
+
+#
+# Run one test, recording its run time if the simulator was actually run
+#
+run_one() {
+    local isa=$1
+    local test=$2
+    local start=$(date +%s.%N)
+    local output rc
+
+    output=$(${MAKE:-make} -s -C ${ROOTDIR}/riscv-test-suite/${isa} \
+        RISCV_DEVICE=${isa} RISCV_ISA=${isa} $(cat ${QUEUE}/${isa}.settings) \
+        RISCV_TEST=${test} run 2>&1)
+    rc=$?
+
+    [ -n "${output}" ] && echo "${output}"
+
+    if [ ${rc} -ne 0 ]; then
+        echo "Error: ${isa} ${test} failed to run"
+        echo "${isa} ${test}" >> ${QUEUE}/failed
+    elif [[ "${output}" == *"Execute "* ]]; then
+        echo "${RISCV_TARGET} ${isa} ${test}" \
+            $(echo "${start} $(date +%s.%N)" | awk '{print $2 - $1}') \
+            >> ${QUEUE}/new
+    fi
+}
+
+export -f run_one
+export QUEUE
+
+printf "Running %d tests with %d jobs\n" \
+    $(wc -l < ${QUEUE}/queue) ${SCHEDULE_JOBS}
+
+xargs -P ${SCHEDULE_JOBS} -L1 bash -c 'run_one $0 $1' < ${QUEUE}/queue
+
+# merge new run times, latest wins
+if [ -f ${QUEUE}/new ]; then
+    mkdir -p $(dirname ${SCHEDULE_TIMES})
+    awk '{ t[$1 " " $2 " " $3] = $4 } END { for(k in t) print k, t[k] }' \
+        ${QUEUE}/times ${QUEUE}/new | sort > ${SCHEDULE_TIMES}.$$ && \
+        mv ${SCHEDULE_TIMES}.$$ ${SCHEDULE_TIMES}
+fi
+
+#
+# Verify each variant
+#
+status=0
+if [ -f ${QUEUE}/failed ]; then
+    status=1
+fi
+
+for isa in "$@"; do
+    RISCV_ISA=${isa} RISCV_DEVICE=${isa} \
+    SUITEDIR=${ROOTDIR}/riscv-test-suite/${isa} \
+        ${ROOTDIR}/riscv-test-env/verify.sh || status=1
+done
+
+${ROOTDIR}/riscv-test-env/profile.sh "$@" || status=1
+
+exit ${status}
@@ -1,38 +1,141 @@
 #!/bin/bash
 
+#
+# Compare each reference_output against its signature, in parallel.
+#
+# VERIFY_JOBS sets the number of concurrent comparisons (default: number of
+# host CPUs). Results are also written to verify.json and verify.junit.xml in
+# ${WORK}/${RISCV_ISA}. For a failing test, the index of the first
+# mismatching signature word is reported together with the source line of
+# the matching "# Testcase <n>" entry, if any.
+#
+
 printf "\n\nCompare to reference files ... \n\n";
 FAIL=0
 RUN=0
 
+WORKDIR=${WORK}/${RISCV_ISA}
+RESULTS=$(mktemp -d)
+trap 'rm -rf ${RESULTS}' EXIT
+
+if [ -z "${VERIFY_JOBS}" ]; then
+    VERIFY_JOBS=$(nproc 2> /dev/null || echo 1)
+fi
+
+#
+# Compare one reference with its signature, writing a single result line
+# "status|word|expected|actual|testcase" to ${RESULTS}/<stub>
+#
+compare() {
+    local ref=$1
+    local base=$(basename ${ref})
+    local stub=${base//".reference_output"/}
+    local sig=${WORKDIR}/${stub}.signature.output
+    local src=${SUITEDIR}/src/${stub}.S
+    local result word testcase
+
+    if [ ! -f ${sig} ]; then
+        echo "IGNORE||||" > ${RESULTS}/${stub}
+        return
+    fi
+
+    # find first mismatching word (case-insensitive, ignoring trailing CR)
+    result=$(awk '
+        { line = tolower($0); sub(/\r$/, "", line) }
+        FILENAME == ARGV[1] { ref[FNR] = line; nref = FNR; next }
+        { sig[FNR] = line; nsig = FNR; if(!first && (line != ref[FNR])) first = FNR }
+        END {
+            if(!first && (nsig != nref)) first = ((nsig < nref) ? nsig : nref) + 1
+            if(!first) { print "OK" ; exit }
+            want = (first <= nref) ? ref[first] : "<missing>"
+            got = (first <= nsig) ? sig[first] : "<missing>"
+            print "FAIL|" first-1 "|" want "|" got
+        }
+    ' ${ref} ${sig})
+
+    if [ "${result}" == "OK" ]; then
+        echo "OK||||" > ${RESULTS}/${stub}
+        return
+    fi
+
+    # map word index to the test case that stores it
+    word=$(echo "${result}" | cut -d'|' -f2)
+    if [ -f ${src} ]; then
+        testcase=$(grep -m1 "# Testcase ${word}\$" ${src} | \
+            sed 's/^[[:space:]]*//; s/[[:space:]]*#.*$//; s/|/ /g')
+    fi
+
+    echo "${result}|${testcase}" > ${RESULTS}/${stub}
+}
+
+export -f compare
+export RESULTS WORKDIR SUITEDIR
+
+ls ${SUITEDIR}/references/*.reference_output | \
+    xargs -P ${VERIFY_JOBS} -I{} bash -c 'compare {}'
+
+#
+# Escape text for JSON and XML output
+#
+json() {
+    local s=${1//\\/\\\\}
+    echo -n "${s//\"/\\\"}"
+}
+
+xml() {
+    local s=${1//&/"&amp;"}
+    s=${s//</"&lt;"}
+    s=${s//>/"&gt;"}
+    echo -n "${s//\"/"&quot;"}"
+}
+
+JSON_TESTS=""
+JUNIT_TESTS=""
+SKIP=0
+
 for ref in ${SUITEDIR}/references/*.reference_output;
-do 
+do
     base=$(basename ${ref})
     stub=${base//".reference_output"/}
-    sig=${WORK}/${RISCV_ISA}/${stub}.signature.output
 
     RUN=$((${RUN} + 1))
-    
-    #
-    # Ensure both files exist
-    #
-    if [ -f ${ref} ] && [ -f ${sig} ]; then 
-        echo -n "Check $(printf %24s ${stub})"
-    else
-        echo    "Check $(printf %24s ${stub}) ... IGNORE"
-        continue
-    fi
-    diff --ignore-case --strip-trailing-cr ${ref} ${sig} #&> /dev/null
-    if [ $? == 0 ]
-    then
-        echo " ... OK"
-    else
-        echo " ... FAIL"
-        FAIL=$((${FAIL} + 1))
-    fi
+
+    IFS='|' read status word expected actual testcase < ${RESULTS}/${stub}
+
+    case ${status} in
+        IGNORE)
+            echo "Check $(printf %24s ${stub}) ... IGNORE"
+            SKIP=$((${SKIP} + 1))
+            detail=""
+            junit="<skipped/>"
+            ;;
+        OK)
+            echo "Check $(printf %24s ${stub}) ... OK"
+            detail=""
+            junit=""
+            ;;
+        *)
+            message="word ${word}: expected ${expected}, got ${actual}"
+            if [ -n "${testcase}" ]; then
+                message="${message} (${testcase})"
+            fi
+            echo "Check $(printf %24s ${stub}) ... FAIL: ${message}"
+            FAIL=$((${FAIL} + 1))
+            detail=", \"word\": ${word}, \"expected\": \"$(json "${expected}")\""
+            detail="${detail}, \"actual\": \"$(json "${actual}")\""
+            detail="${detail}, \"testcase\": \"$(json "${testcase}")\""
+            junit="<failure message=\"$(xml "${message}")\"/>"
+            ;;
+    esac
+
+    JSON_TESTS="${JSON_TESTS}${JSON_TESTS:+,}
+    {\"name\": \"${stub}\", \"status\": \"${status,,}\"${detail}}"
+    JUNIT_TESTS="${JUNIT_TESTS}
+  <testcase classname=\"${RISCV_TARGET}.${RISCV_ISA}\" name=\"${stub}\">${junit}</testcase>"
 done
 
 # warn on missing reverse reference
-for sig in ${WORK}/${RISCV_ISA}/*.signature.output; 
+for sig in ${WORKDIR}/*.signature.output;
 do
     base=$(basename ${sig})
     stub=${base//".signature.output"/}
@@ -44,6 +147,27 @@ do
     fi
 done
 
+# write structured results
+if [ -d ${WORKDIR} ]; then
+    cat > ${WORKDIR}/verify.json <<EOF
+{
+  "target": "${RISCV_TARGET}",
+  "device": "${RISCV_DEVICE}",
+  "isa": "${RISCV_ISA}",
+  "run": ${RUN},
+  "failed": ${FAIL},
+  "skipped": ${SKIP},
+  "tests": [${JSON_TESTS}
+  ]
+}
+EOF
+    cat > ${WORKDIR}/verify.junit.xml <<EOF
+<?xml version="1.0" encoding="UTF-8"?>
+<testsuite name="${RISCV_TARGET}.${RISCV_ISA}" tests="${RUN}" failures="${FAIL}" skipped="${SKIP}">${JUNIT_TESTS}
+</testsuite>
+EOF
+fi
+
 declare -i status=0
 if [ ${FAIL} == 0 ]; then
     echo "--------------------------------"